@@ -0,0 +1,239 @@
+/*
+This file contains the batch solver for files that hold many boards.
+The boards are independent, so a pool of worker threads each keep their own
+board and pull the next unsolved puzzle from a shared counter. Every result
+goes into the slot of its puzzle, so the results come back in input order
+no matter which thread finished first.
+*/
+
+#ifndef BATCH_SOLVER
+#define BATCH_SOLVER
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <thread>
+#include <atomic>
+#include "board.h"
+#include "dlx.h"
+#include "puzzlefile.h"
+#include "canon.h"
+#include "grader.h"
+
+using namespace std;
+
+// the solver a batch runs on every board
+enum SolveEngine {
+    Backtracking, // board::search with the batch's solveOptions
+    DancingLinks, // dlx, Algorithm X on the exact-cover matrix
+    CountSolutions // board::countSolutions, stopping at the batch's limit
+};
+
+// what solving one board of a batch produced
+struct batchResult {
+    string solution; // the solved board as 81 characters, the puzzle itself if unsolved
+    bool solved; // false if the board has no solution
+    long long recursiveCalls; // recursive calls the solver made
+    long long guesses; // values the search tried in cells it branched on, see solveStats
+    long long backtracks; // guesses it took back
+    int maxDepth; // most guesses in force at once
+    long long solutions; // solutions found, a full count up to the limit if counted
+    bool counted; // true if the board was solved with CountSolutions
+    bool aborted; // the search gave up at a budget or a stop before it finished
+    bool invalid; // a character is not '.' or a value of the board, nothing was searched
+};
+
+// totals over a whole batch
+struct batchTotals {
+    int numBoards = 0;
+    int numSolved = 0;
+    int numAborted = 0;
+    int numInvalid = 0;
+    long long recursiveCalls = 0;
+};
+
+// the solver state of one worker: its board, and the exact-cover matrix and
+// canonicalizer when the engine and cache need them. Building them is most
+// of the cost of a small board, so a worker builds one and reuses it.
+// DancingLinks is only there for 9x9 boards. With a cache, 9x9 boards solved
+// by Backtracking are looked up by their canonical form first and the
+// solutions found are added to it; a board found there is not searched.
+// A board with characters other than '.' and '1' to '9' has no canonical
+// form and goes straight to the search
+template <int Sq>
+class boardSolver {
+public:
+    boardSolver(const solveOptions& opts, SolveEngine engine = Backtracking,
+                long long limit = 2, solutionCache* cache = nullptr);
+    void solve(const char* cells, batchResult& r); // solve one board of NumCells characters
+    void grade(const char* cells, puzzleGrade& g); // grade one board instead, see grader.h
+
+private:
+    basicBoard<Sq> b;
+    solveOptions opts; // options of the solves, put back after a grade
+    vector<dlx> d; // one matrix for DancingLinks, none otherwise
+    vector<canonicalizer> canon; // one canonicalizer with a cache, none otherwise
+    SolveEngine engine;
+    long long limit; // solutions CountSolutions stops at
+    solutionCache* cache; // nullptr unless canon holds a canonicalizer
+};
+
+template <int Sq>
+inline boardSolver<Sq>::boardSolver(const solveOptions& opts, SolveEngine engine,
+                                    long long limit, solutionCache* cache) :
+    opts(opts), d(Sq == 3 && engine == DancingLinks ? 1 : 0),
+    canon(Sq == 3 && engine == Backtracking && cache ? 1 : 0),
+    engine(engine), limit(limit), cache(canon.empty() ? nullptr : cache) {
+    b.setOptions(opts);
+    if (!d.empty()) {
+        d[0].setOptions(opts);
+    }
+}
+
+// solve one board into r
+template <int Sq>
+inline void boardSolver<Sq>::solve(const char* cells, batchResult& r) {
+    r.invalid = !isBoardText(cells, basicBoard<Sq>::NumCells, basicBoard<Sq>::MaxValue);
+    if (r.invalid) {
+        r.solution.assign(cells, basicBoard<Sq>::NumCells);
+        r.solved = r.counted = r.aborted = false;
+        r.solutions = r.recursiveCalls = r.guesses = r.backtracks = r.maxDepth = 0;
+        return;
+    }
+    canonicalForm form;
+    bool cached = cache && isPlainBoard(cells);
+    if (cached) {
+        form = canon[0].canonicalize(cells);
+        string solution;
+        if (cache->find(form.cells, solution)) {
+            r.solution = applyTransform(invertTransform(form.transform), solution.c_str());
+            r.solved = true;
+            r.counted = false;
+            r.aborted = false;
+            r.solutions = 1;
+            r.recursiveCalls = r.guesses = r.backtracks = r.maxDepth = 0;
+            return;
+        }
+    }
+    if (!d.empty()) {
+        d[0].initialize(cells);
+        r.solutions = d[0].countSolutions(1);
+        r.recursiveCalls = d[0].getRecursiveCalls();
+        r.guesses = d[0].getStats().guesses;
+        r.backtracks = d[0].getStats().backtracks;
+        r.maxDepth = d[0].getStats().maxDepth;
+        r.aborted = d[0].getStats().aborted;
+        if constexpr (Sq == 3) {
+            d[0].copyTo(b);
+        }
+    } else {
+        b.initialize(cells);
+        r.solutions = engine == CountSolutions ? b.countSolutions(limit) : b.search();
+        r.recursiveCalls = b.getRecursiveCalls();
+        r.guesses = b.getStats().guesses;
+        r.backtracks = b.getStats().backtracks;
+        r.maxDepth = b.getStats().maxDepth;
+        r.aborted = b.getStats().aborted;
+    }
+    r.solved = r.solutions > 0;
+    r.counted = engine == CountSolutions;
+    r.solution = r.counted && r.solved ? b.getSolution() : b.toString();
+    if (cached && r.solved) {
+        cache->insert(form.cells, applyTransform(form.transform, r.solution.c_str()));
+    }
+}
+
+// grade one board into g; the grader sets options of its own, so the
+// solver's are put back afterwards
+template <int Sq>
+inline void boardSolver<Sq>::grade(const char* cells, puzzleGrade& g) {
+    b.initialize(cells);
+    g = gradeBoard(b);
+    b.setOptions(opts);
+}
+
+// solve boards first to last - 1 with numThreads workers and return the
+// results in input order; record(k) gives the characters of board k, Sq is
+// the size of its squares, and limit only matters to CountSolutions. See
+// boardSolver for the engines and the cache
+template <int Sq, typename Records>
+vector<batchResult> solveBoards(const Records& record, size_t first, size_t last,
+                                int numThreads, const solveOptions& opts,
+                                SolveEngine engine = Backtracking, long long limit = 2,
+                                solutionCache* cache = nullptr) {
+    // workers claim a few boards at a time to keep the shared counter cold
+    const size_t Chunk = 16;
+    vector<batchResult> results(last > first ? last - first : 0);
+    atomic<size_t> next(0);
+
+    auto worker = [&]() {
+        boardSolver<Sq> solver(opts, engine, limit, cache);
+        while (true) {
+            size_t from = next.fetch_add(Chunk);
+            if (from >= results.size()) {
+                return;
+            }
+            size_t to = min(from + Chunk, results.size());
+            for (size_t k = from; k < to; ++k) {
+                solver.solve(record(first + k), results[k]);
+            }
+        }
+    };
+
+    if (numThreads < 1) {
+        numThreads = 1;
+    }
+    vector<thread> pool;
+    for (int t = 1; t < numThreads; ++t) {
+        pool.push_back(thread(worker));
+    }
+    worker(); // the calling thread is worker number one
+    for (size_t t = 0; t < pool.size(); ++t) {
+        pool[t].join();
+    }
+    return results;
+}
+
+// solve boards first to last - 1 one after another with a solver the caller
+// keeps, see solveBoards
+template <int Sq, typename Records>
+vector<batchResult> solveBoards(boardSolver<Sq>& solver, const Records& record,
+                                size_t first, size_t last) {
+    vector<batchResult> results(last > first ? last - first : 0);
+    for (size_t k = 0; k < results.size(); ++k) {
+        solver.solve(record(first + k), results[k]);
+    }
+    return results;
+}
+
+// solve 9x9 boards first to last - 1, see solveBoards
+template <typename Records>
+vector<batchResult> solveRecords(const Records& record, size_t first, size_t last,
+                                 int numThreads, const solveOptions& opts,
+                                 SolveEngine engine = Backtracking, long long limit = 2) {
+    return solveBoards<3>(record, first, last, numThreads, opts, engine, limit);
+}
+
+// solve the boards of a mapped file that start in the byte range [begin, end),
+// straight from the mapping; the whole file by default
+inline vector<batchResult> solveBatch(const puzzleFile& file, int numThreads,
+                                      const solveOptions& opts,
+                                      size_t begin = 0, size_t end = size_t(-1)) {
+    auto record = [&](size_t k) { return file.record(k); };
+    return solveRecords(record, file.boardAt(begin), file.boardAt(end), numThreads, opts);
+}
+
+// add up the statistics of a batch
+inline batchTotals sumBatch(const vector<batchResult>& results) {
+    batchTotals totals;
+    for (size_t k = 0; k < results.size(); ++k) {
+        ++totals.numBoards;
+        totals.numSolved += results[k].solved;
+        totals.numAborted += results[k].aborted;
+        totals.numInvalid += results[k].invalid;
+        totals.recursiveCalls += results[k].recursiveCalls;
+    }
+    return totals;
+}
+
+#endif	// BATCH_SOLVER
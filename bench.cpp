@@ -0,0 +1,270 @@
+/*
+This file contains the benchmark for the solving engines.
+It is a program of its own, built apart from board.cpp, e.g.
+    g++ -O2 -DNDEBUG -pthread -o bench bench.cpp
+
+Every engine is run over every puzzle set on one thread: first a few warmup
+passes that are not timed, then repeated timed passes with every puzzle
+timed on its own. For each set and engine it reports the mean, median, 99th
+percentile and worst time per puzzle, puzzles per second and search nodes
+(recursive calls) per second. The sets are the files named on the command
+line (sudoku.txt and sudoku3.txt by default) and a generated set made by
+applying random symmetries from transform.h to the boards of the first
+file, so it is as hard as that file but different from it. The node counts
+do not depend on the machine, so two versions of the solvers can be compared
+by diffing the tab-separated results written with -o.
+*/
+
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <random>
+#include <algorithm>
+#include <cstdlib>
+#include "board.h"
+#include "dlx.h"
+#include "puzzlefile.h"
+#include "transform.h"
+
+using namespace std;
+
+// the puzzles one line of results is measured over
+struct benchSet {
+    string name;
+    vector<string> puzzles;
+};
+
+// the summary of one engine over one set
+struct benchStats {
+    int puzzles = 0; // puzzles in the set
+    int solved = 0; // puzzles the engine solved in one pass
+    long long nodes = 0; // recursive calls for one pass over the set
+    double mean = 0; // microseconds per puzzle
+    double p50 = 0;
+    double p99 = 0;
+    double max = 0;
+    double puzzlesPerSecond = 0;
+    double nodesPerSecond = 0;
+};
+
+// the engines the benchmark knows
+const char* const EngineNames[] = {"backtrack", "dlx", "count"};
+const int NumEngines = 3;
+
+// solve one puzzle with an engine and return the nodes it searched;
+// solved is set if it found a solution
+inline long long runEngine(int engine, const char* cells, board& b, dlx& d, bool& solved) {
+    if (engine == 1) {
+        d.initialize(cells);
+        solved = d.countSolutions(1) > 0;
+        return d.getRecursiveCalls();
+    }
+    b.initialize(cells);
+    solved = engine == 0 ? b.search() : b.countSolutions(2) > 0;
+    return b.getRecursiveCalls();
+}
+
+// return the value at a fraction of a sorted list, nearest rank
+inline double percentile(const vector<double>& sorted, double fraction) {
+    size_t rank = size_t(fraction * sorted.size() + 0.999999);
+    return sorted[rank == 0 ? 0 : rank - 1];
+}
+
+// run an engine over a set: warmup passes, then timed passes
+inline benchStats runBench(int engine, const benchSet& set, int warmup, int repeats) {
+    board b;
+    dlx d;
+    solveOptions opts;
+    opts.select = MinRemaining;
+    opts.propagate = true;
+    if (engine == 2) {
+        // a count has to search the whole tree, locked candidates pay for themselves
+        opts.techniques = techniqueBit(LockedCandidates);
+    }
+    b.setOptions(opts);
+
+    benchStats stats;
+    stats.puzzles = set.puzzles.size();
+    bool solved;
+    for (int pass = 0; pass < warmup; ++pass) {
+        for (size_t k = 0; k < set.puzzles.size(); ++k) {
+            runEngine(engine, set.puzzles[k].c_str(), b, d, solved);
+        }
+    }
+
+    vector<double> times;
+    times.reserve(set.puzzles.size() * repeats);
+    double total = 0;
+    for (int pass = 0; pass < repeats; ++pass) {
+        long long nodes = 0;
+        int numSolved = 0;
+        for (size_t k = 0; k < set.puzzles.size(); ++k) {
+            auto start = chrono::steady_clock::now();
+            nodes += runEngine(engine, set.puzzles[k].c_str(), b, d, solved);
+            auto end = chrono::steady_clock::now();
+            double micros = chrono::duration<double, micro>(end - start).count();
+            times.push_back(micros);
+            total += micros;
+            numSolved += solved;
+        }
+        stats.nodes = nodes;
+        stats.solved = numSolved;
+    }
+    if (times.empty()) {
+        return stats;
+    }
+
+    sort(times.begin(), times.end());
+    stats.mean = total / times.size();
+    stats.p50 = percentile(times, 0.50);
+    stats.p99 = percentile(times, 0.99);
+    stats.max = times.back();
+    stats.puzzlesPerSecond = times.size() / (total / 1e6);
+    stats.nodesPerSecond = double(stats.nodes) * repeats / (total / 1e6);
+    return stats;
+}
+
+// print how to run the benchmark
+inline void printBenchUsage(const char* program) {
+    cerr << "Usage: " << program << " [options] [file ...]\n"
+         << "Time every engine over each file (sudoku.txt and sudoku3.txt by default)\n"
+         << "and over a set generated from the first file.\n"
+         << "  -e, --engine ENGINE    only run backtrack, dlx or count\n"
+         << "  -w, --warmup N         untimed passes before timing (default 1)\n"
+         << "  -r, --repeats N        timed passes (default 5)\n"
+         << "  -g, --generated N      boards in the generated set, 0 for none (default 1000)\n"
+         << "      --seed N           seed for the generated set (default 1)\n"
+         << "  -o, --out FILE         write the results as tab-separated lines to FILE\n";
+}
+
+int main(int argc, char* argv[]) {
+    vector<string> files;
+    int onlyEngine = -1;
+    long long warmup = 1;
+    long long repeats = 5;
+    long long generated = 1000;
+    long long seed = 1;
+    string outName;
+
+    for (int k = 1; k < argc; ++k) {
+        string arg = argv[k];
+        if (arg[0] != '-') {
+            files.push_back(arg);
+            continue;
+        }
+        if (k + 1 >= argc) {
+            printBenchUsage(argv[0]);
+            return 2;
+        }
+        string val = argv[++k];
+        char* end;
+        long long n = strtoll(val.c_str(), &end, 10);
+        bool number = !val.empty() && *end == '\0' && n >= 0;
+        bool ok = true;
+        if (arg == "-e" || arg == "--engine") {
+            for (int e = 0; e < NumEngines; ++e) {
+                if (val == EngineNames[e]) {
+                    onlyEngine = e;
+                }
+            }
+            ok = onlyEngine >= 0;
+        } else if (arg == "-w" || arg == "--warmup") {
+            ok = number;
+            warmup = n;
+        } else if (arg == "-r" || arg == "--repeats") {
+            ok = number && n > 0;
+            repeats = n;
+        } else if (arg == "-g" || arg == "--generated") {
+            ok = number;
+            generated = n;
+        } else if (arg == "--seed") {
+            ok = number;
+            seed = n;
+        } else if (arg == "-o" || arg == "--out") {
+            outName = val;
+        } else {
+            ok = false;
+        }
+        if (!ok) {
+            printBenchUsage(argv[0]);
+            return 2;
+        }
+    }
+    if (files.empty()) {
+        files = {"sudoku.txt", "sudoku3.txt"};
+    }
+
+    vector<benchSet> sets;
+    try {
+        for (size_t f = 0; f < files.size(); ++f) {
+            puzzleFile file;
+            file.open(files[f]);
+            benchSet set;
+            set.name = files[f];
+            for (int k = 0; k < file.size(); ++k) {
+                set.puzzles.push_back(string(file.record(k), RecordSize));
+            }
+            sets.push_back(set);
+        }
+    } catch (fileOpenError& ex) {
+        cerr << argv[0] << ": " << ex.what() << endl;
+        return 1;
+    }
+    if (generated > 0 && !sets[0].puzzles.empty()) {
+        // the same seed always gives the same set
+        mt19937 rng(seed);
+        benchSet set;
+        set.name = "generated";
+        const vector<string>& source = sets[0].puzzles;
+        for (long long k = 0; k < generated; ++k) {
+            boardTransform t = randomTransform(rng);
+            set.puzzles.push_back(applyTransform(t, source[k % source.size()].c_str()));
+        }
+        sets.push_back(set);
+    }
+
+    ofstream out;
+    if (!outName.empty()) {
+        out.open(outName);
+        if (!out) {
+            cerr << argv[0] << ": Cannot open " << outName << endl;
+            return 1;
+        }
+        out << fixed << setprecision(2);
+        out << "set\tengine\tpuzzles\tsolved\tnodes\tmean_us\tp50_us\tp99_us\tmax_us"
+            << "\tpuzzles_per_s\tnodes_per_s\n";
+    }
+
+    cout << left << setw(14) << "set" << setw(11) << "engine" << right
+         << setw(8) << "puzzles" << setw(12) << "nodes" << setw(10) << "mean us"
+         << setw(10) << "p50 us" << setw(10) << "p99 us" << setw(10) << "max us"
+         << setw(12) << "puzzles/s" << setw(14) << "nodes/s" << '\n';
+    cout << fixed;
+    for (size_t s = 0; s < sets.size(); ++s) {
+        for (int e = 0; e < NumEngines; ++e) {
+            if (onlyEngine >= 0 && e != onlyEngine) {
+                continue;
+            }
+            benchStats stats = runBench(e, sets[s], warmup, repeats);
+            cout << left << setw(14) << sets[s].name << setw(11) << EngineNames[e] << right
+                 << setw(8) << stats.puzzles << setw(12) << stats.nodes
+                 << setprecision(1) << setw(10) << stats.mean << setw(10) << stats.p50
+                 << setw(10) << stats.p99 << setw(10) << stats.max
+                 << setprecision(0) << setw(12) << stats.puzzlesPerSecond
+                 << setw(14) << stats.nodesPerSecond << endl;
+            if (stats.solved != stats.puzzles) {
+                cout << "  " << stats.puzzles - stats.solved << " puzzles not solved" << endl;
+            }
+            if (out.is_open()) {
+                out << sets[s].name << '\t' << EngineNames[e] << '\t' << stats.puzzles << '\t'
+                    << stats.solved << '\t' << stats.nodes << '\t' << stats.mean << '\t'
+                    << stats.p50 << '\t' << stats.p99 << '\t' << stats.max << '\t'
+                    << stats.puzzlesPerSecond << '\t' << stats.nodesPerSecond << '\n';
+            }
+        }
+    }
+    return 0;
+}
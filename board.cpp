@@ -9,8 +9,12 @@ Option 2: sudoku2.txt
 Option 3: sudoku3.txt
 Option 4: sudoku.txt (multiple boards)
 Option 5: sudoku1-3.txt (multiple boards)
+Each file can be solved with the backtracking solver in board.h or the
+dancing links (exact cover) solver in dlx.h
 
 The solved board(s) is(are) then printed along with the number of recursive calls
+Run with arguments (e.g. --help) to skip the menu and solve files or standard
+input from the command line, see cli.h
 The average calculator does not work exactly as planned, I've tried to trouble shoot but its not working as designed
 */
 
@@ -20,217 +24,21 @@ The average calculator does not work exactly as planned, I've tried to trouble s
 #include <fstream>
 #include <vector>
 #include <string>
-#include "d_matrix.h"
-#include "d_except.h"
+#include "board.h"
+#include "dlx.h"
+#include "batch.h"
+#include "parallel.h"
+#include "output.h"
+#include "cli.h"
 
 using namespace std;
 
-typedef int ValueType; // The type of the value in a cell
-const int Blank = -1;  // Indicates that a cell is blank
-
-const int SquareSize = 3;  // The number of cells in a small square
-const int BoardSize = SquareSize * SquareSize;
-const int MinValue = 1;
-const int MaxValue = 9;
-
-class board {
-public:
-    board(); // constructor
-    void clear(); // clear the board
-    void initialize(ifstream& fin); // initialize the board with values from each file
-    void print(); // print the board
-    bool isBlank(int i, int j); // check if a cell is blank
-    ValueType getCell(int i, int j); // get the value of a cell
-    void printConflicts(); // print conflicts in rows, columns, adn sqaures
-    bool solve(); // solve the board using backtracking
-    bool checkConflicts(int i, int j, ValueType val); // check if placing a value creates conflicts
-    void setCell(int i, int j, ValueType val); // set a cell to a value
-    void resetCell(int i, int j); // reset a cell to blank
-
-private:
-    matrix<ValueType> value; // matrix to store the board values
-    vector<vector<bool>> rowConflicts; // track conflicts in rows
-    vector<vector<bool>> colConflicts; // track conflicts in columns
-    vector<vector<bool>> squareConflicts; // track conflicts in squares
-    int recursiveCalls; // count the number of recursive calls
-
-    void updateConflicts(int i, int j, ValueType val, bool conflict); // update the conflict trackers
-    bool solveRecursive(); // recursive function to solve the board
-};
-
-board::board() : value(BoardSize + 1, BoardSize + 1) {
-    clear();
-}
-
-void board::clear() {
-   // set all cells to blank
-    for (int i = 1; i <= BoardSize; ++i) {
-        for (int j = 1; j <= BoardSize; ++j) {
-            value[i][j] = Blank;
-        }
-    }
-    // initialize conflict trackers
-    rowConflicts.assign(BoardSize + 1, vector<bool>(MaxValue + 1, false));
-    colConflicts.assign(BoardSize + 1, vector<bool>(MaxValue + 1, false));
-    squareConflicts.assign(BoardSize + 1, vector<bool>(MaxValue + 1, false));
-    recursiveCalls = 0;
-}
-
-// initialize the board with values from a file
-void board::initialize(ifstream& fin) {
-    char ch;
-    clear();
-
-    for (int i = 1; i <= BoardSize; ++i) {
-        for (int j = 1; j <= BoardSize; ++j) {
-            fin >> ch;
-            if (ch != '.') {
-                setCell(i, j, ch - '0');
-            }
-        }
-    }
-}
-
-// print the board
-void board::print() {
-    for (int i = 1; i <= BoardSize; ++i) {
-        if ((i - 1) % SquareSize == 0) {
-            cout << " -";
-            for (int j = 1; j <= BoardSize; ++j) {
-                cout << "---";
-            }
-            cout << "-";
-            cout << endl;
-        }
-        for (int j = 1; j <= BoardSize; ++j) {
-            if ((j - 1) % SquareSize == 0) {
-                cout << "|";
-            }
-            if (!isBlank(i, j)) {
-                cout << " " << getCell(i, j) << " ";
-            } else {
-                cout << "   ";
-            }
-        }
-        cout << "|";
-        cout << endl;
-    }
-    cout << " -";
-    for (int j = 1; j <= BoardSize; ++j) {
-        cout << "---";
-    }
-    cout << "-";
-    cout << endl;
-}
-
-// check if a cell is blank
-bool board::isBlank(int i, int j) {
-    return (getCell(i, j) == Blank);
-}
-
-// get the value of a cell
-ValueType board::getCell(int i, int j) {
-    if (i < 1 || i > BoardSize || j < 1 || j > BoardSize) {
-        throw rangeError("getCell: invalid index");
+int main(int argc, char* argv[]) {
+    // with arguments, run without the menu, see cli.h
+    if (argc > 1) {
+        return runCommandLine(argc, argv);
     }
-    return value[i][j];
-}
 
-// print conflicts in rows, columns, and sqaures (not used in part b)
-void board::printConflicts() {
-    cout << "Row Conflicts:" << endl;
-    for (int i = 1; i <= BoardSize; ++i) {
-        cout << "Row " << i << ": ";
-        for (int val = MinValue; val <= MaxValue; ++val) {
-            if (rowConflicts[i][val]) {
-                cout << val << " ";
-            }
-        }
-        cout << endl;
-    }
-
-    cout << "Column Conflicts:" << endl;
-    for (int j = 1; j <= BoardSize; ++j) {
-        cout << "Column " << j << ": ";
-        for (int val = MinValue; val <= MaxValue; ++val) {
-            if (colConflicts[j][val]) {
-                cout << val << " ";
-            }
-        }
-        cout << endl;
-    }
-
-    cout << "Square Conflicts:" << endl;
-    for (int k = 1; k <= BoardSize; ++k) {
-        cout << "Square " << k << ": ";
-        for (int val = MinValue; val <= MaxValue; ++val) {
-            if (squareConflicts[k][val]) {
-                cout << val << " ";
-            }
-        }
-        cout << endl;
-    }
-}
-
-// check if placing a value creates conflicts
-bool board::checkConflicts(int i, int j, ValueType val) {
-    int square = SquareSize * ((i - 1) / SquareSize) + (j - 1) / SquareSize + 1;
-    return rowConflicts[i][val] || colConflicts[j][val] || squareConflicts[square][val];
-}
-
-// set a cell to a value
-void board::setCell(int i, int j, ValueType val) {
-    value[i][j] = val;
-    updateConflicts(i, j, val, true);
-}
-
-// reset a cell to blank
-void board::resetCell(int i, int j) {
-    int val = value[i][j];
-    value[i][j] = Blank;
-    updateConflicts(i, j, val, false);
-}
-
-// update conflict trackers
-void board::updateConflicts(int i, int j, ValueType val, bool conflict) {
-    int square = SquareSize * ((i - 1) / SquareSize) + (j - 1) / SquareSize + 1;
-    rowConflicts[i][val] = conflict;
-    colConflicts[j][val] = conflict;
-    squareConflicts[square][val] = conflict;
-}
-
-// solve the board using backtracking
-bool board::solve() {
-    recursiveCalls = 0;
-    bool solved = solveRecursive();
-    cout << "Number of recursive calls: " << recursiveCalls << endl;
-    return solved;
-}
-
-// recursive function to solve the board
-bool board::solveRecursive() {
-    ++recursiveCalls;
-
-    for (int i = 1; i <= BoardSize; ++i) {
-        for (int j = 1; j <= BoardSize; ++j) {
-            if (isBlank(i, j)) {
-                for (int val = MinValue; val <= MaxValue; ++val) {
-                    if (!checkConflicts(i, j, val)) {
-                        setCell(i, j, val);
-                        if (solveRecursive()) {
-                            return true;
-                        }
-                        resetCell(i, j);
-                    }
-                }
-                return false;
-            }
-        }
-    }
-    return true;
-}
-
-int main() {
     ifstream fin;
     int fileNumber;
     // List of file names to read from
@@ -245,6 +53,31 @@ int main() {
             continue;
         }
 
+        int engine;
+        cout << "Enter the solver (1 = backtracking, 2 = dancing links, 3 = count solutions): ";
+        cin >> engine;
+
+        long long limit = 1;
+        if (engine == 3) {
+            cout << "Enter the most solutions to count (2 = check uniqueness): ";
+            cin >> limit;
+        }
+
+        int numThreads = 1;
+        if (engine == 1) {
+            cout << "Enter the number of threads (1 = one board at a time): ";
+            cin >> numThreads;
+        }
+
+        int format = 1;
+        if (numThreads > 1 && fileNumber > 3) {
+            cout << "Enter the output format (1 = grids, 2 = one line per board, 3 = JSON lines, 4 = binary): ";
+            cin >> format;
+            if (format < 1 || format > 4) {
+                format = 1;
+            }
+        }
+
         string fileName = files[fileNumber - 1];
         fin.open(fileName);
         if (!fin) {
@@ -252,22 +85,92 @@ int main() {
             return 1;
         }
 
-        int totalRecursiveCalls = 0;
+        long long totalRecursiveCalls = 0;
         int numBoards = 0;
 
         try {
             board b;
-            // read and solve each board in the file (if applicable)
-            while (fin && fin.peek() != 'Z') {
+            solveOptions opts;
+            opts.select = MinRemaining;
+            opts.propagate = true;
+            b.setOptions(opts);
+            dlx d;
+            if (engine == 3) {
+                // count the solutions of each board, stopping at the limit;
+                // locked candidates pay for themselves when the whole tree
+                // has to be searched
+                opts.techniques = techniqueBit(LockedCandidates);
+                b.setOptions(opts);
+                while (fin && fin.peek() != 'Z') {
+                    b.initialize(fin);
+                    b.print();
+                    long long count = b.countSolutions(limit);
+                    cout << "Number of solutions: " << count;
+                    if (count >= limit) {
+                        cout << " (stopped at the limit)";
+                    }
+                    cout << endl;
+                    cout << "Number of recursive calls: " << b.getRecursiveCalls() << endl;
+                    totalRecursiveCalls += b.getRecursiveCalls();
+                    ++numBoards;
+                }
+            } else if (numThreads > 1 && fileNumber <= 3) {
+                // a single board gets all the threads inside its own search
                 b.initialize(fin);
                 b.print();
-                if (b.solve()) {
+                long long calls = 0;
+                bool aborted = false;
+                bool solved = solveParallel(b, opts, numThreads, 2, calls, aborted);
+                cout << "Number of recursive calls: " << calls << endl;
+                if (solved) {
                     cout << "Solved board:" << endl;
                     b.print();
+                } else if (aborted) {
+                    cout << "The search gave up before it finished." << endl;
                 } else {
                     cout << "No solution exists for this board." << endl;
                 }
-                totalRecursiveCalls += b.solve();
+                totalRecursiveCalls = calls;
+                numBoards = 1;
+            } else if (numThreads > 1) {
+                // solve the whole file on a pool of threads, then write the
+                // boards in the order they were read through one buffer
+                puzzleFile puzzles;
+                puzzles.open(fileName);
+                vector<batchResult> results = solveBatch(puzzles, numThreads, opts);
+                {
+                    outputWriter out(cout);
+                    for (size_t k = 0; k < results.size(); ++k) {
+                        out.writeResult(OutputFormat(format - 1), k, puzzles.record(k), results[k]);
+                    }
+                }
+                batchTotals totals = sumBatch(results);
+                totalRecursiveCalls = totals.recursiveCalls;
+                numBoards = totals.numBoards;
+            }
+            // read and solve each board in the file (if applicable)
+            while (engine != 3 && numThreads <= 1 && fin && fin.peek() != 'Z') {
+                if (engine == 2) {
+                    // the exact-cover engine reads the board itself and
+                    // copies its grid into b for printing
+                    d.initialize(fin);
+                    d.copyTo(b);
+                } else {
+                    b.initialize(fin);
+                }
+                b.print();
+                solveStats stats = engine == 2 ? d.solve() : b.solve();
+                cout << "Number of recursive calls: " << stats.nodes << endl;
+                if (stats.solved) {
+                    if (engine == 2) {
+                        d.copyTo(b);
+                    }
+                    cout << "Solved board:" << endl;
+                    b.print();
+                } else {
+                    cout << "No solution exists for this board." << endl;
+                }
+                totalRecursiveCalls += stats.nodes;
                 ++numBoards;
             }
         } catch (indexRangeError &ex) {
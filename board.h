@@ -0,0 +1,1438 @@
+/*
+This file contains the board class shared by every engine and tool in the project.
+The board stores the values of a 9x9 grid (or a 16x16 or 25x25 one, see
+basicBoard) and, for every row, column and square, a bitmask of the values
+that are still legal there. solve() fills in the blank cells with
+backtracking, kept on an explicit stack of decisions rather than the call
+stack (see searchStack). A search can be given a node and a time budget and
+stopped from another thread, see searchBudget; it then gives up and says so
+in its statistics.
+*/
+
+#ifndef BOARD_CLASS
+#define BOARD_CLASS
+
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <climits>
+#include <atomic>
+#include <chrono>
+#include "d_matrix.h"
+#include "d_except.h"
+#include "simd.h"
+
+using namespace std;
+
+typedef int ValueType; // The type of the value in a cell
+const int Blank = -1;  // Indicates that a cell is blank
+
+const int SquareSize = 3;  // The number of cells in a small square
+const int BoardSize = SquareSize * SquareSize;
+const int MinValue = 1;
+const int MaxValue = 9;
+
+typedef uint16_t ValueMask; // one bit per value, bit (val - MinValue) stands for val
+const ValueMask AllValues = (1 << (MaxValue - MinValue + 1)) - 1;
+
+// return the bit that stands for val in a ValueMask
+inline ValueMask valueBit(ValueType val) {
+    return ValueMask(1) << (val - MinValue);
+}
+
+// return the smallest value whose bit is set in a non-empty mask
+inline ValueType lowestValue(ValueMask mask) {
+    return __builtin_ctz(mask) + MinValue;
+}
+
+// return the square number of cell i,j (1 to BoardSize, left to right, top to bottom)
+inline int squareNumber(int i, int j) {
+    return SquareSize * ((i - 1) / SquareSize) + (j - 1) / SquareSize + 1;
+}
+
+const int NumUnits = 3 * BoardSize; // rows, then columns, then squares
+
+// return the k-th cell (0 to BoardSize - 1) of a unit as (i - 1) * BoardSize + (j - 1)
+inline int unitCell(int unit, int k) {
+    if (unit < BoardSize) {
+        return unit * BoardSize + k;
+    } else if (unit < 2 * BoardSize) {
+        return k * BoardSize + unit - BoardSize;
+    }
+    int square = unit - 2 * BoardSize;
+    return (SquareSize * (square / SquareSize) + k / SquareSize) * BoardSize
+        + SquareSize * (square % SquareSize) + k % SquareSize;
+}
+
+// how the search picks the blank cell to branch on
+enum SelectMode {
+    FirstBlank, // the first blank cell in row-major order
+    MinRemaining // the blank cell with the fewest legal values
+};
+
+// elimination rules that propagation can run once singles run dry
+enum Technique {
+    LockedCandidates, // pointing and claiming: a value confined to a square and a line
+    NakedPairs, // two cells of a unit sharing the same two values
+    NakedTriples, // three cells of a unit holding only three values between them
+    HiddenPairs, // two values of a unit confined to the same two cells
+    HiddenTriples, // three values of a unit confined to the same three cells
+    XWing, // a value confined to the same two columns in two rows, or the reverse
+    Swordfish, // the same with three rows and three columns
+    NumTechniques
+};
+
+// return the solveOptions::techniques bit that turns on a technique
+inline unsigned techniqueBit(Technique t) {
+    return 1u << t;
+}
+
+// build with -DSUDOKU_STATS=0 to compile the search statistics out of the
+// solvers; the checks below are then constant false and cost nothing
+#ifndef SUDOKU_STATS
+#define SUDOKU_STATS 1
+#endif
+const bool CollectStats = SUDOKU_STATS;
+
+// what one solve or count did; with SUDOKU_STATS off only solved and nodes
+// are filled in
+struct solveStats {
+    bool solved = false; // true if a solution was found
+    bool aborted = false; // the search gave up at a budget or a stop before it finished
+    uint64_t nodes = 0; // recursive calls
+    uint64_t guesses = 0; // values tried in a cell the search branched on
+    uint64_t backtracks = 0; // guesses taken back after their subtree was searched
+    uint64_t singles = 0; // values placed by propagation
+    uint64_t eliminations = 0; // candidates removed by elimination techniques
+    int maxDepth = 0; // most guesses in force at once
+    vector<uint64_t> depth; // nodes by the number of guesses in force
+    vector<uint64_t> fanout; // branching cells by their number of candidates
+};
+
+// settings that control how solve() searches
+struct solveOptions {
+    SelectMode select = FirstBlank;
+    bool propagate = false; // place naked and hidden singles after every placement
+    unsigned techniques = 0; // techniqueBit of each extra rule propagation runs
+    const atomic<bool>* stop = nullptr; // the search gives up once this becomes true
+    long long maxNodes = 0; // recursive calls a search may make, 0 for no limit
+    atomic<long long>* nodePool = nullptr; // with maxNodes, nodes shared with other searches:
+        // the search takes maxNodes at a time from it and gives back what it did not use
+    long long maxMillis = 0; // milliseconds a search may take, 0 for no limit
+    bool vectorScan = true; // let the simd.h kernel pick cells and find naked singles (9x9 only)
+};
+
+// take up to want nodes from a shared budget, 0 if it is spent
+inline long long takeNodes(atomic<long long>& pool, long long want) {
+    long long left = pool.load();
+    long long share;
+    do {
+        if (left <= 0) {
+            return 0;
+        }
+        share = min(want, left);
+    } while (!pool.compare_exchange_weak(left, left - share));
+    return share;
+}
+
+// the limits of one search: the stop flag of its options, read at every
+// node, and its node and time budgets. The budgets cost a compare per node,
+// the clock is only read every ClockInterval nodes. With a node pool the
+// search only gives up on nodes once the pool is empty
+class searchBudget {
+public:
+    void start(const solveOptions& opts); // a new search under the limits of opts
+    bool exceeded(long long nodes); // true once the search has to give up, then for good;
+        // nodes is the number made so far, the next would be one more
+    bool aborted() const; // true if the search gave up before it finished
+    void finish(long long nodes); // the search is over after nodes, give the rest back to the pool
+
+    static const long long ClockInterval = 1024;
+
+private:
+    const atomic<bool>* stop;
+    long long maxNodes; // nodes the search may make, 0 for no limit
+    atomic<long long>* pool; // where more nodes come from, nullptr for none
+    long long poolShare; // nodes taken from the pool at a time
+    bool timed; // there is a deadline
+    chrono::steady_clock::time_point deadline;
+    long long nextCheck; // nodes at which the budgets are checked next
+    bool gaveUp;
+
+    bool check(long long nodes); // check the budgets, slow path of exceeded
+};
+
+// start a search: the clock starts now
+inline void searchBudget::start(const solveOptions& opts) {
+    stop = opts.stop;
+    maxNodes = opts.maxNodes;
+    pool = opts.maxNodes > 0 ? opts.nodePool : nullptr;
+    poolShare = opts.maxNodes;
+    gaveUp = false;
+    if (pool) {
+        maxNodes = takeNodes(*pool, poolShare);
+        gaveUp = maxNodes == 0;
+    }
+    timed = opts.maxMillis > 0;
+    if (timed) {
+        deadline = chrono::steady_clock::now() + chrono::milliseconds(opts.maxMillis);
+    }
+    nextCheck = timed ? ClockInterval : LLONG_MAX;
+    if (maxNodes > 0) {
+        nextCheck = min(nextCheck, maxNodes);
+    }
+}
+
+// check the limits at a node, nodes being the nodes visited so far
+inline bool searchBudget::exceeded(long long nodes) {
+    if (stop && stop->load(memory_order_relaxed)) {
+        gaveUp = true;
+    }
+    return nodes >= nextCheck ? check(nodes) : gaveUp;
+}
+
+inline bool searchBudget::check(long long nodes) {
+    if (maxNodes > 0 && nodes >= maxNodes) {
+        long long more = pool ? takeNodes(*pool, poolShare) : 0;
+        maxNodes += more;
+        gaveUp = gaveUp || more == 0;
+    }
+    if (timed && chrono::steady_clock::now() >= deadline) {
+        gaveUp = true;
+    }
+    if (gaveUp) {
+        nextCheck = LLONG_MAX; // nothing left to check, exceeded returns gaveUp
+        return true;
+    }
+    nextCheck = timed ? nodes + ClockInterval : LLONG_MAX;
+    if (maxNodes > 0) {
+        nextCheck = min(nextCheck, maxNodes);
+    }
+    return false;
+}
+
+inline bool searchBudget::aborted() const {
+    return gaveUp;
+}
+
+inline void searchBudget::finish(long long nodes) {
+    if (pool && maxNodes > nodes) {
+        *pool += maxNodes - nodes;
+        maxNodes = nodes;
+    }
+}
+
+// the types that fit each board size: a value mask needs one bit per value
+// and a cell index has to reach BoardSize * BoardSize
+template <int Sq> struct boardTraits;
+
+template <> struct boardTraits<3> { // 9x9
+    typedef uint16_t Mask;
+    typedef unsigned char Cell;
+};
+
+template <> struct boardTraits<4> { // 16x16
+    typedef uint32_t Mask;
+    typedef uint16_t Cell;
+};
+
+template <> struct boardTraits<5> { // 25x25
+    typedef uint32_t Mask;
+    typedef uint16_t Cell;
+};
+
+// return the character a value is written as: 1 to 9, then A, B, C and so on
+inline char valueChar(ValueType val) {
+    return val <= 9 ? '0' + val : 'A' + val - 10;
+}
+
+// return the value a character stands for, Blank for '.', 0 if it is not a value
+inline ValueType charValue(char ch) {
+    if (ch == '.') {
+        return Blank;
+    } else if (ch >= '1' && ch <= '9') {
+        return ch - '0';
+    } else if (ch >= 'A' && ch <= 'Z') {
+        return ch - 'A' + 10;
+    } else if (ch >= 'a' && ch <= 'z') {
+        return ch - 'a' + 10;
+    }
+    return 0;
+}
+
+// check that all n characters of a board are '.' or stand for a value from
+// 1 to maxValue, so the board can be read and written back unchanged
+inline bool isBoardText(const char* cells, size_t n, int maxValue) {
+    for (size_t k = 0; k < n; ++k) {
+        ValueType val = charValue(cells[k]);
+        if (val != Blank && (val < MinValue || val > maxValue)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// the board for squares of Sq by Sq cells, Sq = 3, 4 or 5; every size gets
+// its own copy of the solver with its own mask width and loop bounds, and
+// only the 9x9 board uses the simd.h kernel. Inside the class the size
+// constants and mask helpers below hide the 9x9 ones declared above
+template <int Sq>
+class basicBoard {
+public:
+    static const int SquareSize = Sq; // The number of cells in a small square
+    static const int BoardSize = Sq * Sq;
+    static const int NumCells = BoardSize * BoardSize;
+    static const int MaxValue = BoardSize;
+    static const int NumUnits = 3 * BoardSize; // rows, then columns, then squares
+    typedef typename boardTraits<Sq>::Mask ValueMask; // bit (val - MinValue) stands for val
+    static const ValueMask AllValues = (ValueMask(1) << (BoardSize - 1) << 1) - 1;
+
+    static ValueMask valueBit(ValueType val); // the bit that stands for val
+    static ValueType lowestValue(ValueMask mask); // smallest value in a non-empty mask
+    static int squareNumber(int i, int j); // square of cell i,j, 1 to BoardSize
+    static int unitCell(int unit, int k); // k-th cell of a unit
+
+    basicBoard(); // constructor
+    void clear(); // clear the board
+    void initialize(ifstream& fin); // initialize the board with values from each file
+    void initialize(const char* cells); // initialize the board from NumCells characters in file format
+    string toString(); // the board as NumCells characters in file format
+    void print(); // print the board
+    bool isBlank(int i, int j); // check if a cell is blank
+    ValueType getCell(int i, int j); // get the value of a cell
+    void printConflicts(); // print conflicts in rows, columns, adn sqaures
+    solveStats solve(); // solve the board using backtracking and return what it took
+    bool search(); // solve the board, see getStats for what it took
+    long long countSolutions(long long limit); // count solutions, stopping once limit are found
+    bool reduce(); // run propagation on the board as it stands, false on a contradiction
+    long long getRecursiveCalls(); // recursive calls made by the last solve
+    const solveStats& getStats(); // statistics of the last solve, search or count
+    string getSolution(); // first solution the last search found, empty if none
+    bool checkConflicts(int i, int j, ValueType val); // check if placing a value creates conflicts
+    ValueMask candidates(int i, int j); // legal values for a cell, the unit masks ANDed together
+    void setCell(int i, int j, ValueType val); // set a cell to a value
+    void resetCell(int i, int j); // reset a cell to blank
+    void forbid(int i, int j, ValueType val); // rule a value out of a cell until the next clear
+    void setOptions(const solveOptions& opts); // choose how the next solve() searches
+    long long techniqueRuns(Technique t); // times the last solve() tried a technique
+    long long techniqueEliminations(Technique t); // candidates a technique removed in the last solve()
+
+private:
+    typedef typename boardTraits<Sq>::Cell CellIndex; // (i - 1) * BoardSize + (j - 1)
+    // cell masks are padded for the kernel's row loads on the 9x9 board
+    static const int PaddedCells = Sq == 3 ? ScanPadded : NumCells;
+
+    matrix<ValueType> value; // matrix to store the board values
+    ValueMask rowFree[BoardSize + 1]; // values still legal in each row
+    ValueMask colFree[BoardSize + 1]; // values still legal in each column
+    ValueMask squareFree[BoardSize + 1]; // values still legal in each square
+    ValueMask blankCols[BoardSize + 1]; // columns still blank in each row, bit j - 1 for column j
+    ValueMask allowed[PaddedCells]; // values not yet ruled out in each cell by a technique
+    bool consistent; // false if the givens already conflict with each other
+    long long recursiveCalls; // count the number of recursive calls
+    solveStats stats; // what the current search has done, see CollectStats
+    int depth; // guesses in force at the current node
+    long long solutions; // solutions found by the current search
+    long long solutionLimit; // the search stops once it has found this many
+    char firstSolution[NumCells]; // the first full board the search reached
+    solveOptions options; // how solve() searches
+    searchBudget budget; // the stop flag and budgets of the current search
+    CellIndex emptyCells[NumCells]; // blank cells as (i - 1) * BoardSize + (j - 1)
+    CellIndex emptyPos[NumCells]; // index of each cell in emptyCells
+    int numEmpty; // blank cells still unassigned, packed at the front of emptyCells
+    CellIndex trail[NumCells]; // cells placed by propagation, undone on backtrack
+    int trailSize; // number of entries in trail
+    struct elimination {
+        CellIndex cell; // cell whose allowed mask changed
+        ValueMask before; // the mask before the change
+    };
+    elimination elims[NumCells * BoardSize]; // technique eliminations, undone on backtrack
+    int elimSize; // number of entries in elims
+    // one node of the search on the decision stack
+    struct searchFrame {
+        int i, j; // cell the node branches on
+        ValueMask cand; // values not yet tried in it
+        int mark; // trail, eliminations and blank list when the node was entered,
+        int elimMark; // restored when the search leaves it
+        int empty;
+    };
+    // every guess fills a blank cell, so the root and one frame per guess in force fit
+    searchFrame frames[NumCells + 1];
+    enum nodeState { NodeBranch, NodeSolved, NodeFailed }; // what opening a node found
+    long long runs[NumTechniques]; // times each technique was tried
+    long long eliminated[NumTechniques]; // candidates each technique removed
+
+    void updateConflicts(int i, int j, ValueType val); // flip val in the row, column and square masks
+    template <bool Listed> bool searchStack(); // backtracking over frames, true once the limit is reached
+    template <bool Listed> nodeState openNode(searchFrame& f); // enter a node and pick its cell
+    void collectBlanks(); // fill the blank list from the grid and empty the trails
+    bool runSearch(); // search with the current solution limit, true once it is reached
+    bool foundSolution(); // count a full board, true once the limit is reached
+    void enterGuess(); // count a guess before searching below it
+    bool leaveGuess(bool found); // count a guess after its search, returns found
+    int chooseCell(); // index in emptyCells of the cell to branch on, -1 if one has no value left
+    void removeEmpty(int cell); // take a cell out of the blank list
+    bool propagate(); // place singles and run techniques until nothing changes, false on a contradiction
+    bool propagateSingles(); // place naked and hidden singles until nothing changes
+    bool propagateScanned(); // propagateSingles driven by the simd.h kernel
+    void assign(int cell, ValueType val); // place a value found by propagation
+    void undo(int mark, int elimMark, int empty); // take back propagation down to the trail marks
+    ValueMask unitFree(int unit); // values still legal in a unit
+    ValueMask cellCandidates(int cell); // candidates of a cell, 0 once it has a value
+    int eliminate(int cell, ValueMask mask); // rule values out of a cell, returns how many went
+    bool applyTechniques(); // run the enabled techniques until one eliminates something
+    int lockedCandidates(); // pointing and claiming eliminations
+    int nakedSubsets(int n); // eliminations from n cells holding n values between them
+    int hiddenSubsets(int n); // eliminations from n values confined to n cells
+    int fish(int n); // X-Wing (n = 2) and Swordfish (n = 3) eliminations
+    void scan(scanResult& out); // run the simd.h kernel over the whole grid, 9x9 only
+};
+
+typedef basicBoard<3> board; // the 9x9 board every engine and tool uses
+typedef basicBoard<4> board16; // 16x16
+typedef basicBoard<5> board25; // 25x25
+
+template <int Sq>
+inline typename basicBoard<Sq>::ValueMask basicBoard<Sq>::valueBit(ValueType val) {
+    return ValueMask(1) << (val - MinValue);
+}
+
+template <int Sq>
+inline ValueType basicBoard<Sq>::lowestValue(ValueMask mask) {
+    return __builtin_ctz(mask) + MinValue;
+}
+
+template <int Sq>
+inline int basicBoard<Sq>::squareNumber(int i, int j) {
+    return SquareSize * ((i - 1) / SquareSize) + (j - 1) / SquareSize + 1;
+}
+
+// return the k-th cell (0 to BoardSize - 1) of a unit as (i - 1) * BoardSize + (j - 1)
+template <int Sq>
+inline int basicBoard<Sq>::unitCell(int unit, int k) {
+    if (unit < BoardSize) {
+        return unit * BoardSize + k;
+    } else if (unit < 2 * BoardSize) {
+        return k * BoardSize + unit - BoardSize;
+    }
+    int square = unit - 2 * BoardSize;
+    return (SquareSize * (square / SquareSize) + k / SquareSize) * BoardSize
+        + SquareSize * (square % SquareSize) + k % SquareSize;
+}
+
+template <int Sq>
+inline basicBoard<Sq>::basicBoard() : value(BoardSize + 1, BoardSize + 1) {
+    clear();
+}
+
+template <int Sq>
+inline void basicBoard<Sq>::clear() {
+   // set all cells to blank
+    for (int i = 1; i <= BoardSize; ++i) {
+        for (int j = 1; j <= BoardSize; ++j) {
+            value[i][j] = Blank;
+        }
+    }
+    // every value is legal everywhere on an empty board
+    for (int k = 0; k <= BoardSize; ++k) {
+        rowFree[k] = colFree[k] = squareFree[k] = AllValues;
+        blankCols[k] = (ValueMask(1) << (BoardSize - 1) << 1) - 1;
+    }
+    for (int k = 0; k < NumCells; ++k) {
+        allowed[k] = AllValues;
+    }
+    for (int k = NumCells; k < PaddedCells; ++k) {
+        allowed[k] = 0;
+    }
+    consistent = true;
+    recursiveCalls = 0;
+}
+
+// initialize the board with values from a file
+template <int Sq>
+inline void basicBoard<Sq>::initialize(ifstream& fin) {
+    char cells[NumCells];
+    for (int k = 0; k < NumCells; ++k) {
+        fin >> cells[k];
+    }
+    initialize(cells);
+}
+
+// initialize the board from NumCells characters, row by row, '.' for a blank
+// cell and valueChar for the rest
+template <int Sq>
+inline void basicBoard<Sq>::initialize(const char* cells) {
+    clear();
+
+    for (int i = 1; i <= BoardSize; ++i) {
+        for (int j = 1; j <= BoardSize; ++j) {
+            ValueType val = charValue(*cells++);
+            if (val == Blank) {
+                continue;
+            }
+            // a value too big for the board or a given that repeats a value
+            // in its row, column or square can never be part of a solution
+            if (val < MinValue || val > MaxValue) {
+                consistent = false;
+            } else if (checkConflicts(i, j, val)) {
+                consistent = false;
+                value[i][j] = val;
+                blankCols[i] &= ~(1 << (j - 1));
+            } else {
+                setCell(i, j, val);
+            }
+        }
+    }
+}
+
+// get the board as NumCells characters, row by row, '.' for a blank cell
+template <int Sq>
+inline string basicBoard<Sq>::toString() {
+    string cells(NumCells, '.');
+    for (int i = 1; i <= BoardSize; ++i) {
+        for (int j = 1; j <= BoardSize; ++j) {
+            if (!isBlank(i, j)) {
+                cells[(i - 1) * BoardSize + (j - 1)] = valueChar(getCell(i, j));
+            }
+        }
+    }
+    return cells;
+}
+
+// print the board
+template <int Sq>
+inline void basicBoard<Sq>::print() {
+    for (int i = 1; i <= BoardSize; ++i) {
+        if ((i - 1) % SquareSize == 0) {
+            cout << " -";
+            for (int j = 1; j <= BoardSize; ++j) {
+                cout << "---";
+            }
+            cout << "-";
+            cout << '\n';
+        }
+        for (int j = 1; j <= BoardSize; ++j) {
+            if ((j - 1) % SquareSize == 0) {
+                cout << "|";
+            }
+            if (!isBlank(i, j)) {
+                cout << " " << valueChar(getCell(i, j)) << " ";
+            } else {
+                cout << "   ";
+            }
+        }
+        cout << "|";
+        cout << '\n';
+    }
+    cout << " -";
+    for (int j = 1; j <= BoardSize; ++j) {
+        cout << "---";
+    }
+    cout << "-";
+    cout << '\n';
+}
+
+// check if a cell is blank
+template <int Sq>
+inline bool basicBoard<Sq>::isBlank(int i, int j) {
+    return (getCell(i, j) == Blank);
+}
+
+// get the value of a cell
+template <int Sq>
+inline ValueType basicBoard<Sq>::getCell(int i, int j) {
+    if (i < 1 || i > BoardSize || j < 1 || j > BoardSize) {
+        throw rangeError("getCell: invalid index");
+    }
+    return value[i][j];
+}
+
+// print conflicts in rows, columns, and sqaures (not used in part b)
+template <int Sq>
+inline void basicBoard<Sq>::printConflicts() {
+    cout << "Row Conflicts:" << endl;
+    for (int i = 1; i <= BoardSize; ++i) {
+        cout << "Row " << i << ": ";
+        for (int val = MinValue; val <= MaxValue; ++val) {
+            if (!(rowFree[i] & valueBit(val))) {
+                cout << val << " ";
+            }
+        }
+        cout << endl;
+    }
+
+    cout << "Column Conflicts:" << endl;
+    for (int j = 1; j <= BoardSize; ++j) {
+        cout << "Column " << j << ": ";
+        for (int val = MinValue; val <= MaxValue; ++val) {
+            if (!(colFree[j] & valueBit(val))) {
+                cout << val << " ";
+            }
+        }
+        cout << endl;
+    }
+
+    cout << "Square Conflicts:" << endl;
+    for (int k = 1; k <= BoardSize; ++k) {
+        cout << "Square " << k << ": ";
+        for (int val = MinValue; val <= MaxValue; ++val) {
+            if (!(squareFree[k] & valueBit(val))) {
+                cout << val << " ";
+            }
+        }
+        cout << endl;
+    }
+}
+
+// check if placing a value creates conflicts
+template <int Sq>
+inline bool basicBoard<Sq>::checkConflicts(int i, int j, ValueType val) {
+    return !(candidates(i, j) & valueBit(val));
+}
+
+// get the values that can still be placed in a cell
+template <int Sq>
+inline typename basicBoard<Sq>::ValueMask basicBoard<Sq>::candidates(int i, int j) {
+    return rowFree[i] & colFree[j] & squareFree[squareNumber(i, j)]
+        & allowed[(i - 1) * BoardSize + (j - 1)];
+}
+
+// set a blank cell to a legal value
+template <int Sq>
+inline void basicBoard<Sq>::setCell(int i, int j, ValueType val) {
+    value[i][j] = val;
+    updateConflicts(i, j, val);
+}
+
+// reset a cell to blank
+template <int Sq>
+inline void basicBoard<Sq>::resetCell(int i, int j) {
+    int val = value[i][j];
+    if (val == Blank) {
+        return;
+    }
+    value[i][j] = Blank;
+    updateConflicts(i, j, val);
+}
+
+// rule a value out of a cell for every search until the board is cleared or
+// initialized again, e.g. to look for a solution other than a known one
+template <int Sq>
+inline void basicBoard<Sq>::forbid(int i, int j, ValueType val) {
+    allowed[(i - 1) * BoardSize + (j - 1)] &= ~valueBit(val);
+}
+
+// update conflict trackers, placing and removing a value are the same XOR
+template <int Sq>
+inline void basicBoard<Sq>::updateConflicts(int i, int j, ValueType val) {
+    ValueMask bit = valueBit(val);
+    rowFree[i] ^= bit;
+    colFree[j] ^= bit;
+    squareFree[squareNumber(i, j)] ^= bit;
+    blankCols[i] ^= 1 << (j - 1);
+}
+
+// choose how the next solve() searches
+template <int Sq>
+inline void basicBoard<Sq>::setOptions(const solveOptions& opts) {
+    options = opts;
+}
+
+// get the number of times the last solve() tried a technique
+template <int Sq>
+inline long long basicBoard<Sq>::techniqueRuns(Technique t) {
+    return runs[t];
+}
+
+// get the number of candidates a technique removed in the last solve()
+template <int Sq>
+inline long long basicBoard<Sq>::techniqueEliminations(Technique t) {
+    return eliminated[t];
+}
+
+// solve the board using backtracking and return the statistics of the search
+template <int Sq>
+inline solveStats basicBoard<Sq>::solve() {
+    search();
+    return stats;
+}
+
+// get the number of recursive calls made by the last solve
+template <int Sq>
+inline long long basicBoard<Sq>::getRecursiveCalls() {
+    return recursiveCalls;
+}
+
+// get the statistics of the last solve, search or count
+template <int Sq>
+inline const solveStats& basicBoard<Sq>::getStats() {
+    return stats;
+}
+
+// get the first solution the last search or count found, empty if there was none
+template <int Sq>
+inline string basicBoard<Sq>::getSolution() {
+    return solutions > 0 ? string(firstSolution, NumCells) : string();
+}
+
+// solve the board using backtracking without printing anything
+template <int Sq>
+inline bool basicBoard<Sq>::search() {
+    solutionLimit = 1;
+    return runSearch();
+}
+
+// count the solutions of the board, stopping as soon as limit have been
+// found; a limit of 2 is a uniqueness check. If the limit is reached the
+// board holds the last solution found, otherwise it is left as it was
+template <int Sq>
+inline long long basicBoard<Sq>::countSolutions(long long limit) {
+    solutionLimit = limit;
+    runSearch();
+    return solutions;
+}
+
+// count a full board, true once the search has found as many as it wants
+template <int Sq>
+inline bool basicBoard<Sq>::foundSolution() {
+    if (solutions == 0) {
+        // a count goes on past this board, so keep a copy of it
+        for (int i = 1; i <= BoardSize; ++i) {
+            for (int j = 1; j <= BoardSize; ++j) {
+                firstSolution[(i - 1) * BoardSize + (j - 1)] = valueChar(value[i][j]);
+            }
+        }
+    }
+    return ++solutions >= solutionLimit;
+}
+
+// count a guess made by the search before it searches below it
+template <int Sq>
+inline void basicBoard<Sq>::enterGuess() {
+    if (CollectStats) {
+        ++stats.guesses;
+        ++depth;
+    }
+}
+
+// count a guess after the search below it, a backtrack unless it reached the limit
+template <int Sq>
+inline bool basicBoard<Sq>::leaveGuess(bool found) {
+    if (CollectStats) {
+        --depth;
+        stats.backtracks += !found;
+    }
+    return found;
+}
+
+// search the board with the current solution limit, true once it is reached
+template <int Sq>
+inline bool basicBoard<Sq>::runSearch() {
+    recursiveCalls = 0;
+    solutions = 0;
+    for (int t = 0; t < NumTechniques; ++t) {
+        runs[t] = eliminated[t] = 0;
+    }
+    stats.guesses = stats.backtracks = stats.singles = stats.eliminations = 0;
+    stats.maxDepth = depth = 0;
+    if (CollectStats) {
+        // assign keeps the capacity, so only the first search allocates
+        stats.depth.assign(NumCells + 1, 0);
+        stats.fanout.assign(BoardSize + 1, 0);
+    }
+    budget.start(options);
+
+    bool solved = false;
+    if (consistent && (options.select == MinRemaining || options.propagate)) {
+        // collect the blank cells once, the search keeps the list up to date
+        collectBlanks();
+        solved = searchStack<true>();
+    } else if (consistent) {
+        solved = searchStack<false>();
+    }
+
+    budget.finish(recursiveCalls);
+    stats.solved = solutions > 0;
+    stats.aborted = budget.aborted();
+    stats.nodes = recursiveCalls;
+    for (int t = 0; t < NumTechniques; ++t) {
+        stats.eliminations += eliminated[t];
+    }
+    return solved;
+}
+
+// run propagation on the board as it stands and keep whatever it places,
+// used to simplify a board before its search is split up
+template <int Sq>
+inline bool basicBoard<Sq>::reduce() {
+    if (!consistent) {
+        return false;
+    }
+    collectBlanks();
+    return !options.propagate || propagate();
+}
+
+// fill the blank list from the grid and empty the undo trails
+template <int Sq>
+inline void basicBoard<Sq>::collectBlanks() {
+    numEmpty = 0;
+    trailSize = 0;
+    elimSize = 0;
+    for (int i = 1; i <= BoardSize; ++i) {
+        for (ValueMask cols = blankCols[i]; cols; cols &= cols - 1) {
+            int cell = (i - 1) * BoardSize + __builtin_ctz(cols);
+            emptyPos[cell] = numEmpty;
+            emptyCells[numEmpty++] = cell;
+        }
+    }
+}
+
+// backtracking search over the decision stack. The search is at a node
+// with level guesses in force above it, whose nodes are frames[0] to
+// frames[level - 1]; a guess pushes a frame and a node that is done pops
+// back to its parent, which takes the guess back and tries its next value. It visits the same nodes in the same
+// order as a recursive search would, and counts each as a recursive call.
+// Listed searches the blank list with propagation, otherwise the search
+// branches on the first blank cell in row-major order
+template <int Sq>
+template <bool Listed>
+inline bool basicBoard<Sq>::searchStack() {
+    // the node the search is at is kept in top rather than in frames, so
+    // it stays in registers until one of its children is searched
+    searchFrame top;
+    top.i = 1; // the root looks for its blank cell from the first row
+    int level = 0;
+    while (true) {
+        nodeState state = openNode<Listed>(top);
+        if (state == NodeSolved) {
+            // a solution goes all the way up and leaves the board solved
+            for ( ; level > 0; --level) {
+                leaveGuess(true);
+            }
+            return true;
+        }
+        // back up to the nearest node with a value left to try, taking back
+        // the guesses on the way, until the budget gives up
+        while (state == NodeFailed || !top.cand || budget.aborted()) {
+            if (Listed && state == NodeBranch) {
+                undo(top.mark, top.elimMark, top.empty);
+            }
+            if (level == 0) {
+                return false;
+            }
+            top = frames[--level];
+            leaveGuess(false);
+            resetCell(top.i, top.j);
+            state = NodeBranch;
+        }
+        // try the values in increasing order
+        setCell(top.i, top.j, lowestValue(top.cand));
+        top.cand &= top.cand - 1;
+        enterGuess();
+        frames[level++] = top;
+    }
+}
+
+// enter a node: check the budget, count the node, propagate and pick the
+// cell to branch on. NodeBranch leaves the cell and its values in f,
+// NodeSolved means the solution limit is reached, and NodeFailed means the
+// node is a dead end and everything it placed is undone
+template <int Sq>
+template <bool Listed>
+inline typename basicBoard<Sq>::nodeState basicBoard<Sq>::openNode(searchFrame& f) {
+    // a node the budget refuses is not counted, so calls stay within maxNodes
+    if (budget.exceeded(recursiveCalls)) {
+        return NodeFailed;
+    }
+    ++recursiveCalls;
+    if (CollectStats) {
+        ++stats.depth[depth];
+        stats.maxDepth = max(stats.maxDepth, depth);
+    }
+
+    if (!Listed) {
+        // the first blank cell in row-major order is the lowest blank column
+        // of the first row that still has one. f holds the parent's cell,
+        // and every cell before it is filled, so the rows above it are skipped
+        for (int i = f.i; i <= BoardSize; ++i) {
+            if (blankCols[i]) {
+                f.i = i;
+                f.j = __builtin_ctz(blankCols[i]) + 1;
+                f.cand = candidates(f.i, f.j);
+                if (CollectStats) {
+                    ++stats.fanout[__builtin_popcount(f.cand)];
+                }
+                return f.cand ? NodeBranch : NodeFailed;
+            }
+        }
+        return foundSolution() ? NodeSolved : NodeFailed;
+    }
+
+    // everything this node places is undone by restoring the trail and
+    // the length of the blank list
+    f.mark = trailSize;
+    f.elimMark = elimSize;
+    f.empty = numEmpty;
+    if (options.propagate && !propagate()) {
+        undo(f.mark, f.elimMark, f.empty);
+        return NodeFailed;
+    }
+    if (numEmpty == 0) {
+        if (foundSolution()) {
+            return NodeSolved;
+        }
+        // keep looking for more solutions
+        undo(f.mark, f.elimMark, f.empty);
+        return NodeFailed;
+    }
+
+    int k = chooseCell();
+    if (k < 0) {
+        undo(f.mark, f.elimMark, f.empty);
+        return NodeFailed;
+    }
+    int cell = emptyCells[k];
+    removeEmpty(cell);
+    f.i = cell / BoardSize + 1;
+    f.j = cell % BoardSize + 1;
+    f.cand = candidates(f.i, f.j);
+    if (CollectStats) {
+        ++stats.fanout[__builtin_popcount(f.cand)];
+    }
+    return NodeBranch;
+}
+
+// pick the blank cell to branch on, -1 if some blank cell has no legal value
+template <int Sq>
+inline int basicBoard<Sq>::chooseCell() {
+    if (options.select == FirstBlank) {
+        for (int i = 1; i <= BoardSize; ++i) {
+            if (blankCols[i]) {
+                return emptyPos[(i - 1) * BoardSize + __builtin_ctz(blankCols[i])];
+            }
+        }
+    }
+
+    if constexpr (Sq == 3) {
+        if (options.vectorScan) {
+            scanResult result;
+            scan(result);
+            return result.bestCount == 0 ? -1 : emptyPos[result.best];
+        }
+    }
+
+    // find the most constrained blank cell, a cell with no legal value
+    // fails this branch straight away
+    int best = 0;
+    int bestCount = MaxValue + 1;
+    for (int k = 0; k < numEmpty && bestCount > 1; ++k) {
+        int cell = emptyCells[k];
+        int count = __builtin_popcount(candidates(cell / BoardSize + 1, cell % BoardSize + 1));
+        if (count < bestCount) {
+            best = k;
+            bestCount = count;
+        }
+    }
+    return bestCount == 0 ? -1 : best;
+}
+
+// swap a cell to the end of the blank list and drop it, undoing that is
+// just growing the list again
+template <int Sq>
+inline void basicBoard<Sq>::removeEmpty(int cell) {
+    int k = emptyPos[cell];
+    int last = emptyCells[numEmpty - 1];
+    emptyCells[k] = last;
+    emptyPos[last] = k;
+    emptyCells[numEmpty - 1] = cell;
+    emptyPos[cell] = numEmpty - 1;
+    --numEmpty;
+}
+
+// place a value found by propagation and remember it on the trail
+template <int Sq>
+inline void basicBoard<Sq>::assign(int cell, ValueType val) {
+    if (CollectStats) {
+        ++stats.singles;
+    }
+    setCell(cell / BoardSize + 1, cell % BoardSize + 1, val);
+    removeEmpty(cell);
+    trail[trailSize++] = cell;
+}
+
+// take back propagation down to the trail marks and restore the blank list
+template <int Sq>
+inline void basicBoard<Sq>::undo(int mark, int elimMark, int empty) {
+    while (trailSize > mark) {
+        int cell = trail[--trailSize];
+        resetCell(cell / BoardSize + 1, cell % BoardSize + 1);
+    }
+    while (elimSize > elimMark) {
+        --elimSize;
+        allowed[elims[elimSize].cell] = elims[elimSize].before;
+    }
+    numEmpty = empty;
+}
+
+// get the values that can still be placed in a row, column or square
+template <int Sq>
+inline typename basicBoard<Sq>::ValueMask basicBoard<Sq>::unitFree(int unit) {
+    if (unit < BoardSize) {
+        return rowFree[unit + 1];
+    } else if (unit < 2 * BoardSize) {
+        return colFree[unit - BoardSize + 1];
+    }
+    return squareFree[unit - 2 * BoardSize + 1];
+}
+
+// place singles, then run the enabled techniques, cheapest first, going
+// back to singles after every technique that eliminates something
+template <int Sq>
+inline bool basicBoard<Sq>::propagate() {
+    while (propagateSingles()) {
+        if (numEmpty == 0 || !options.techniques || !applyTechniques()) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// place naked singles (a cell with one legal value) and hidden singles (a
+// value with one legal cell in a unit) until neither finds anything, false
+// as soon as a cell or a value in a unit has nowhere to go
+template <int Sq>
+inline bool basicBoard<Sq>::propagateSingles() {
+    if constexpr (Sq == 3) {
+        if (options.vectorScan) {
+            return propagateScanned();
+        }
+    }
+    bool changed = true;
+    while (changed) {
+        changed = false;
+
+        for (int k = 0; k < numEmpty; ) {
+            int cell = emptyCells[k];
+            ValueMask cand = candidates(cell / BoardSize + 1, cell % BoardSize + 1);
+            if (!cand) {
+                return false;
+            }
+            if (cand & (cand - 1)) {
+                ++k;
+                continue;
+            }
+            // assign swaps another blank cell into slot k, look at it next
+            assign(cell, lowestValue(cand));
+            changed = true;
+        }
+
+        for (int unit = 0; unit < NumUnits; ++unit) {
+            ValueMask free = unitFree(unit);
+            if (!free) {
+                continue;
+            }
+            // values seen in at least one and in at least two blank cells
+            ValueMask once = 0;
+            ValueMask twice = 0;
+            for (int k = 0; k < BoardSize; ++k) {
+                int cell = unitCell(unit, k);
+                if (blankCols[cell / BoardSize + 1] & (1 << (cell % BoardSize))) {
+                    ValueMask cand = candidates(cell / BoardSize + 1, cell % BoardSize + 1);
+                    twice |= once & cand;
+                    once |= cand;
+                }
+            }
+            if ((once & free) != free) {
+                return false;
+            }
+            for (ValueMask hidden = free & ~twice; hidden; hidden &= hidden - 1) {
+                ValueMask bit = hidden & -hidden;
+                for (int k = 0; k < BoardSize; ++k) {
+                    int cell = unitCell(unit, k);
+                    int i = cell / BoardSize + 1;
+                    int j = cell % BoardSize + 1;
+                    if ((blankCols[i] & (1 << (j - 1))) && (candidates(i, j) & bit)) {
+                        assign(cell, lowestValue(bit));
+                        changed = true;
+                        break;
+                    }
+                }
+            }
+        }
+    }
+    return true;
+}
+
+// propagateSingles driven by the kernel: every pass scans the grid once and
+// places all the naked singles it found, and only when there are none does
+// it look for hidden singles in the candidates the pass computed
+template <int Sq>
+inline bool basicBoard<Sq>::propagateScanned() {
+    scanResult result;
+    while (true) {
+        scan(result);
+        if (result.best < 0) {
+            return true;
+        }
+        if (result.bestCount == 0) {
+            return false;
+        }
+
+        // an earlier placement in the same pass can take a single's value or
+        // its only place, which leaves the board stuck either way
+        bool placed = false;
+        if (result.bestCount == 1) {
+            for (int half = 0; half < 2; ++half) {
+                for (uint64_t bits = result.singles[half]; bits; bits &= bits - 1) {
+                    int cell = 64 * half + __builtin_ctzll(bits);
+                    ValueMask cand = cellCandidates(cell);
+                    if (!cand) {
+                        return false;
+                    }
+                    assign(cell, lowestValue(cand));
+                }
+            }
+            continue;
+        }
+
+        for (int unit = 0; unit < NumUnits; ++unit) {
+            ValueMask free = unitFree(unit);
+            if (!free) {
+                continue;
+            }
+            ValueMask once = 0;
+            ValueMask twice = 0;
+            for (int k = 0; k < BoardSize; ++k) {
+                ValueMask cand = result.cand[unitCell(unit, k)];
+                twice |= once & cand;
+                once |= cand;
+            }
+            if ((once & free) != free) {
+                return false;
+            }
+            for (ValueMask hidden = free & ~twice; hidden; hidden &= hidden - 1) {
+                ValueMask bit = hidden & -hidden;
+                int k = 0;
+                while (!(result.cand[unitCell(unit, k)] & bit)) {
+                    ++k;
+                }
+                int cell = unitCell(unit, k);
+                if (!(cellCandidates(cell) & bit)) {
+                    return false;
+                }
+                assign(cell, lowestValue(bit));
+                placed = true;
+            }
+        }
+        if (!placed) {
+            return true;
+        }
+    }
+}
+
+// run the simd.h kernel over the whole grid
+template <int Sq>
+inline void basicBoard<Sq>::scan(scanResult& out) {
+    scanInput in;
+    in.rowFree = rowFree + 1;
+    in.colFree = colFree + 1;
+    in.squareFree = squareFree + 1;
+    in.blankCols = blankCols + 1;
+    in.allowed = allowed;
+    scanGrid(in, out);
+}
+
+// get the candidates of a cell given as (i - 1) * BoardSize + (j - 1), 0 once it has a value
+template <int Sq>
+inline typename basicBoard<Sq>::ValueMask basicBoard<Sq>::cellCandidates(int cell) {
+    int i = cell / BoardSize + 1;
+    int j = cell % BoardSize + 1;
+    if (!(blankCols[i] & (1 << (j - 1)))) {
+        return 0;
+    }
+    return candidates(i, j);
+}
+
+// rule values out of a blank cell, recording the old mask so undo can restore it
+template <int Sq>
+inline int basicBoard<Sq>::eliminate(int cell, ValueMask mask) {
+    ValueMask gone = cellCandidates(cell) & mask;
+    if (!gone) {
+        return 0;
+    }
+    elims[elimSize].cell = cell;
+    elims[elimSize].before = allowed[cell];
+    ++elimSize;
+    allowed[cell] &= ~mask;
+    return __builtin_popcount(gone);
+}
+
+// run the enabled techniques in order of cost, stopping at the first one
+// that eliminates something so singles get another look
+template <int Sq>
+inline bool basicBoard<Sq>::applyTechniques() {
+    for (int t = 0; t < NumTechniques; ++t) {
+        if (!(options.techniques & techniqueBit(Technique(t)))) {
+            continue;
+        }
+        int removed = 0;
+        switch (t) {
+        case LockedCandidates:
+            removed = lockedCandidates();
+            break;
+        case NakedPairs:
+            removed = nakedSubsets(2);
+            break;
+        case NakedTriples:
+            removed = nakedSubsets(3);
+            break;
+        case HiddenPairs:
+            removed = hiddenSubsets(2);
+            break;
+        case HiddenTriples:
+            removed = hiddenSubsets(3);
+            break;
+        case XWing:
+            removed = fish(2);
+            break;
+        case Swordfish:
+            removed = fish(3);
+            break;
+        }
+        ++runs[t];
+        eliminated[t] += removed;
+        if (removed) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// return the next larger mask with the same number of bits set (Gosper's hack),
+// used to walk the n-element subsets of a unit
+inline unsigned nextSubset(unsigned set) {
+    unsigned low = set & -set;
+    unsigned ripple = set + low;
+    return ripple | (((set ^ ripple) >> 2) / low);
+}
+
+// a value whose candidates in a square all lie on one line cannot go anywhere
+// else on that line (pointing), and a value whose candidates on a line all lie
+// in one square cannot go anywhere else in that square (claiming)
+template <int Sq>
+inline int basicBoard<Sq>::lockedCandidates() {
+    int removed = 0;
+    for (int bandRow = 0; bandRow < SquareSize; ++bandRow) {
+        for (int stackCol = 0; stackCol < SquareSize; ++stackCol) {
+            // candidates of each row and each column segment of the square
+            ValueMask rowSeg[SquareSize] = {};
+            ValueMask colSeg[SquareSize] = {};
+            for (int r = 0; r < SquareSize; ++r) {
+                for (int c = 0; c < SquareSize; ++c) {
+                    ValueMask cand = cellCandidates((bandRow * SquareSize + r) * BoardSize
+                        + stackCol * SquareSize + c);
+                    rowSeg[r] |= cand;
+                    colSeg[c] |= cand;
+                }
+            }
+            for (int r = 0; r < SquareSize; ++r) {
+                ValueMask others = 0;
+                for (int k = 0; k < SquareSize; ++k) {
+                    others |= k == r ? 0 : rowSeg[k];
+                }
+                ValueMask only = rowSeg[r] & ~others;
+                int i = bandRow * SquareSize + r;
+                for (int j = 0; only && j < BoardSize; ++j) {
+                    if (j / SquareSize != stackCol) {
+                        removed += eliminate(i * BoardSize + j, only);
+                    }
+                }
+            }
+            for (int c = 0; c < SquareSize; ++c) {
+                ValueMask others = 0;
+                for (int k = 0; k < SquareSize; ++k) {
+                    others |= k == c ? 0 : colSeg[k];
+                }
+                ValueMask only = colSeg[c] & ~others;
+                int j = stackCol * SquareSize + c;
+                for (int i = 0; only && i < BoardSize; ++i) {
+                    if (i / SquareSize != bandRow) {
+                        removed += eliminate(i * BoardSize + j, only);
+                    }
+                }
+            }
+        }
+    }
+
+    // claiming, rows then columns: the three segments a line has in its squares
+    for (int line = 0; line < 2 * BoardSize; ++line) {
+        bool isRow = line < BoardSize;
+        int index = isRow ? line : line - BoardSize;
+        ValueMask seg[SquareSize] = {};
+        for (int k = 0; k < BoardSize; ++k) {
+            int cell = isRow ? index * BoardSize + k : k * BoardSize + index;
+            seg[k / SquareSize] |= cellCandidates(cell);
+        }
+        for (int t = 0; t < SquareSize; ++t) {
+            ValueMask others = 0;
+            for (int k = 0; k < SquareSize; ++k) {
+                others |= k == t ? 0 : seg[k];
+            }
+            ValueMask only = seg[t] & ~others;
+            if (!only) {
+                continue;
+            }
+            // the square the segment lies in, minus the line itself
+            int square = isRow ? (index / SquareSize) * SquareSize + t : t * SquareSize + index / SquareSize;
+            for (int k = 0; k < BoardSize; ++k) {
+                int cell = unitCell(2 * BoardSize + square, k);
+                int onLine = isRow ? cell / BoardSize : cell % BoardSize;
+                if (onLine != index) {
+                    removed += eliminate(cell, only);
+                }
+            }
+        }
+    }
+    return removed;
+}
+
+// n blank cells of a unit whose candidates together are only n values take
+// those values away from every other cell of the unit
+template <int Sq>
+inline int basicBoard<Sq>::nakedSubsets(int n) {
+    int removed = 0;
+    for (int unit = 0; unit < NumUnits; ++unit) {
+        ValueMask cand[BoardSize];
+        int slot[BoardSize]; // unit positions of the cells with 2 to n candidates
+        int count = 0;
+        for (int k = 0; k < BoardSize; ++k) {
+            cand[k] = cellCandidates(unitCell(unit, k));
+            int size = __builtin_popcount(cand[k]);
+            if (size >= 2 && size <= n) {
+                slot[count++] = k;
+            }
+        }
+        if (count < n) {
+            continue;
+        }
+        for (unsigned set = (1u << n) - 1; set < (1u << count); set = nextSubset(set)) {
+            ValueMask values = 0;
+            unsigned members = 0;
+            for (unsigned bits = set; bits; bits &= bits - 1) {
+                int k = slot[__builtin_ctz(bits)];
+                values |= cand[k];
+                members |= 1u << k;
+            }
+            if (__builtin_popcount(values) != n) {
+                continue;
+            }
+            for (int k = 0; k < BoardSize; ++k) {
+                if (!(members & (1u << k))) {
+                    removed += eliminate(unitCell(unit, k), values);
+                }
+            }
+        }
+    }
+    return removed;
+}
+
+// n values of a unit whose candidates together lie in only n cells leave
+// those cells no room for any other value
+template <int Sq>
+inline int basicBoard<Sq>::hiddenSubsets(int n) {
+    int removed = 0;
+    for (int unit = 0; unit < NumUnits; ++unit) {
+        // the unit positions where each value is still a candidate
+        unsigned where[BoardSize] = {};
+        for (int k = 0; k < BoardSize; ++k) {
+            for (ValueMask cand = cellCandidates(unitCell(unit, k)); cand; cand &= cand - 1) {
+                where[__builtin_ctz(cand)] |= 1u << k;
+            }
+        }
+        int value[BoardSize]; // bit positions of the values with 2 to n places
+        int count = 0;
+        for (int v = 0; v < BoardSize; ++v) {
+            int size = __builtin_popcount(where[v]);
+            if (size >= 2 && size <= n) {
+                value[count++] = v;
+            }
+        }
+        if (count < n) {
+            continue;
+        }
+        for (unsigned set = (1u << n) - 1; set < (1u << count); set = nextSubset(set)) {
+            unsigned cells = 0;
+            ValueMask values = 0;
+            for (unsigned bits = set; bits; bits &= bits - 1) {
+                int v = value[__builtin_ctz(bits)];
+                cells |= where[v];
+                values |= 1 << v;
+            }
+            if (__builtin_popcount(cells) != n) {
+                continue;
+            }
+            for (unsigned bits = cells; bits; bits &= bits - 1) {
+                removed += eliminate(unitCell(unit, __builtin_ctz(bits)), ValueMask(~values));
+            }
+        }
+    }
+    return removed;
+}
+
+// a value whose candidates in n rows all lie in the same n columns cannot go
+// anywhere else in those columns, and the same with rows and columns swapped
+template <int Sq>
+inline int basicBoard<Sq>::fish(int n) {
+    int removed = 0;
+    for (int v = 0; v < BoardSize; ++v) {
+        ValueMask bit = ValueMask(1) << v;
+        for (int byRow = 0; byRow < 2; ++byRow) {
+            // the cross lines (as bits) where the value can go on each base line
+            unsigned where[BoardSize] = {};
+            for (int a = 0; a < BoardSize; ++a) {
+                for (int b = 0; b < BoardSize; ++b) {
+                    int cell = byRow ? a * BoardSize + b : b * BoardSize + a;
+                    if (cellCandidates(cell) & bit) {
+                        where[a] |= 1u << b;
+                    }
+                }
+            }
+            int line[BoardSize]; // base lines with 2 to n places for the value
+            int count = 0;
+            for (int a = 0; a < BoardSize; ++a) {
+                int size = __builtin_popcount(where[a]);
+                if (size >= 2 && size <= n) {
+                    line[count++] = a;
+                }
+            }
+            if (count < n) {
+                continue;
+            }
+            for (unsigned set = (1u << n) - 1; set < (1u << count); set = nextSubset(set)) {
+                unsigned cross = 0;
+                unsigned base = 0;
+                for (unsigned bits = set; bits; bits &= bits - 1) {
+                    int a = line[__builtin_ctz(bits)];
+                    cross |= where[a];
+                    base |= 1u << a;
+                }
+                if (__builtin_popcount(cross) != n) {
+                    continue;
+                }
+                for (unsigned bits = cross; bits; bits &= bits - 1) {
+                    int b = __builtin_ctz(bits);
+                    for (int a = 0; a < BoardSize; ++a) {
+                        if (!(base & (1u << a))) {
+                            removed += eliminate(byRow ? a * BoardSize + b : b * BoardSize + a, bit);
+                        }
+                    }
+                }
+            }
+        }
+    }
+    return removed;
+}
+
+#endif	// BOARD_CLASS
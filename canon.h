@@ -0,0 +1,347 @@
+/*
+This file contains the canonical form of a 9x9 board and a cache of
+solutions keyed by it.
+Two boards that one symmetry of transform.h turns into each other have the
+same canonical form: of all the boards the symmetries give, it is the
+smallest once the values are renumbered in the order they first appear and
+blanks are counted as larger than any value. The canonicalizer builds that
+board a row at a time. For each row it tries every row the symmetries
+allow there, under every column order still tied for the smallest rows so
+far, and drops the choices that are already larger than the best board
+found. Boards with very few givens can tie under so many column orders
+that this would take too long, so after WorkLimit row comparisons it gives
+up and returns the board itself. That is still a correct cache key, it just
+misses the board's symmetric copies.
+
+The cache holds the solution of each canonical board it was given and
+forgets the one used longest ago once it is full. A board in any orientation
+is looked up by its canonical form and the solution mapped back through the
+inverse of the symmetry, so a repeated puzzle skips the search entirely.
+*/
+
+#ifndef BOARD_CANON
+#define BOARD_CANON
+
+#include <string>
+#include <vector>
+#include <list>
+#include <unordered_map>
+#include <mutex>
+#include <cstring>
+#include "board.h"
+#include "transform.h"
+
+using namespace std;
+
+// a board in canonical form and the symmetry that takes the board there
+struct canonicalForm {
+    string cells; // the canonical board, 81 characters in file format
+    boardTransform transform; // applyTransform(transform, board) gives cells
+    bool complete; // false if the search gave up and cells is the board itself
+};
+
+// turns boards into their canonical form; keeps its scratch space between
+// boards, so give each thread one of its own
+class canonicalizer {
+public:
+    canonicalizer();
+    canonicalForm canonicalize(const char* cells); // 81 characters, see isPlainBoard
+
+    static const long WorkLimit = 1 << 20; // row comparisons before giving up on a board
+
+private:
+    static const int NumCells = BoardSize * BoardSize;
+    static const int NumColumnOrders = 1296; // stack orders times column orders in each stack
+    static const unsigned char BlankKey = MaxValue + 1; // blanks sort after every value
+
+    // a column order and transposition still tied for the smallest rows
+    struct candidate {
+        unsigned short order; // index into columns
+        unsigned char transpose; // rows are read from the transposed board
+        unsigned char labels; // values numbered so far
+        unsigned char label[MaxValue + 1]; // new number of each value, 0 if not seen yet
+    };
+
+    unsigned char columns[NumColumnOrders][BoardSize]; // source column of each column
+    int firstShape; // the smallest rowShape of any row
+    unsigned char grid[2][NumCells]; // the board and its transpose, 0 for blank
+    vector<candidate> start; // every column order with both transpositions
+    vector<candidate> found[BoardSize]; // the ties that make each row smallest
+    vector<unsigned char> foundRow[BoardSize]; // source row of each tie
+    unsigned char bestRow[BoardSize][BoardSize]; // the smallest rows found so far
+    int bestDepth; // rows of bestRow that are set
+    int rowOrder[BoardSize]; // source rows picked on the way down
+    boardTransform best; // the symmetry of the smallest board
+    long work; // row comparisons made for this board
+
+    void search(int level, unsigned used, const candidate* cands, size_t numCands);
+    int rowShape(int transpose, int r); // the smallest blank pattern a first row can have
+};
+
+// cache of solutions by canonical board, safe to share between threads
+class solutionCache {
+public:
+    solutionCache(size_t capacity); // most solutions it holds
+    bool find(const string& key, string& solution); // false if the key is not cached
+    void insert(const string& key, const string& solution); // may push out the oldest
+    size_t size(); // solutions held
+    long long hits(); // finds that succeeded
+    long long misses(); // finds that failed
+
+private:
+    typedef list<pair<string, string>> entryList; // most recently used first
+
+    size_t capacity;
+    entryList entries;
+    unordered_map<string, entryList::iterator> index;
+    long long numHits;
+    long long numMisses;
+    mutex lock; // guards everything above
+};
+
+// the column orders are every stack order with every order of the columns
+// inside each stack
+inline canonicalizer::canonicalizer() {
+    int stacks[SquareSize] = {0, 1, 2};
+    int n = 0;
+    do {
+        int inner[SquareSize][SquareSize] = {{0, 1, 2}, {0, 1, 2}, {0, 1, 2}};
+        for (int a = 0; a < 6; ++a) {
+            for (int b = 0; b < 6; ++b) {
+                for (int c = 0; c < 6; ++c) {
+                    for (int s = 0; s < SquareSize; ++s) {
+                        for (int k = 0; k < SquareSize; ++k) {
+                            columns[n][s * SquareSize + k] = stacks[s] * SquareSize + inner[s][k];
+                        }
+                    }
+                    ++n;
+                    next_permutation(inner[2], inner[2] + SquareSize);
+                }
+                next_permutation(inner[1], inner[1] + SquareSize);
+            }
+            next_permutation(inner[0], inner[0] + SquareSize);
+        }
+    } while (next_permutation(stacks, stacks + SquareSize));
+
+    candidate c;
+    memset(&c, 0, sizeof(c));
+    for (int t = 0; t < 2; ++t) {
+        for (int k = 0; k < NumColumnOrders; ++k) {
+            c.order = k;
+            c.transpose = t;
+            start.push_back(c);
+        }
+    }
+}
+
+// return the canonical form of a board
+inline canonicalForm canonicalizer::canonicalize(const char* cells) {
+    for (int i = 0; i < BoardSize; ++i) {
+        for (int j = 0; j < BoardSize; ++j) {
+            char ch = cells[i * BoardSize + j];
+            int v = ch >= '0' + MinValue && ch <= '0' + MaxValue ? ch - '0' : 0;
+            grid[0][i * BoardSize + j] = grid[1][j * BoardSize + i] = v;
+        }
+    }
+    firstShape = 1 << BoardSize;
+    for (int t = 0; t < 2; ++t) {
+        for (int r = 0; r < BoardSize; ++r) {
+            firstShape = min(firstShape, rowShape(t, r));
+        }
+    }
+    bestDepth = 0;
+    work = 0;
+    search(0, 0, start.data(), start.size());
+
+    canonicalForm form;
+    form.complete = work <= WorkLimit;
+    form.transform = form.complete ? best : identityTransform();
+    form.cells = applyTransform(form.transform, cells);
+    return form;
+}
+
+// return the blanks of the smallest first row that row r of the board (or
+// of its transpose) can give, one bit per cell, the first cell highest. The
+// first row numbers its values 1, 2, 3 in order, so only where the blanks
+// fall matters: the stacks with the most givens go first, givens first in
+// each, and only rows with the smallest shape need their column orders tried
+inline int canonicalizer::rowShape(int transpose, int r) {
+    int count[SquareSize] = {};
+    for (int j = 0; j < BoardSize; ++j) {
+        count[j / SquareSize] += grid[transpose][r * BoardSize + j] != 0;
+    }
+    sort(count, count + SquareSize, greater<int>());
+    int shape = 0;
+    for (int s = 0; s < SquareSize; ++s) {
+        for (int k = 0; k < SquareSize; ++k) {
+            shape = shape << 1 | (k >= count[s]);
+        }
+    }
+    return shape;
+}
+
+// pick the source row for row level of the result; cands are the column
+// orders tied for the smallest rows above it, used has a bit per source row
+// taken. Every board reaching the bottom is the smallest found so far
+inline void canonicalizer::search(int level, unsigned used, const candidate* cands,
+                                  size_t numCands) {
+    if (level == BoardSize) {
+        const candidate& c = cands[0];
+        best.transpose = c.transpose;
+        int labels = c.labels;
+        best.digit[0] = 0;
+        for (int v = MinValue; v <= MaxValue; ++v) {
+            // values the board never shows take the numbers left over
+            best.digit[v] = c.label[v] ? c.label[v] : ++labels;
+        }
+        for (int k = 0; k < BoardSize; ++k) {
+            best.row[k] = rowOrder[k];
+            best.col[k] = columns[c.order][k];
+        }
+        return;
+    }
+    if (work > WorkLimit) {
+        return;
+    }
+
+    // a row starting a band may come from any band not used yet, the
+    // others from the band of the row above
+    int firstRow = 0;
+    int lastRow = BoardSize;
+    if (level % SquareSize != 0) {
+        firstRow = rowOrder[level - 1] / SquareSize * SquareSize;
+        lastRow = firstRow + SquareSize;
+    }
+
+    unsigned char minRow[BoardSize];
+    bool haveMin = level < bestDepth;
+    bool improved = !haveMin;
+    if (haveMin) {
+        memcpy(minRow, bestRow[level], BoardSize);
+    }
+    vector<candidate>& ties = found[level];
+    vector<unsigned char>& tieRows = foundRow[level];
+    ties.clear();
+    tieRows.clear();
+    for (int r = firstRow; r < lastRow; ++r) {
+        if (used & (7u << (r / SquareSize * SquareSize)) && level % SquareSize == 0) {
+            continue; // the band is taken
+        }
+        if (used & (1u << r)) {
+            continue;
+        }
+        // the first row skips whole transpositions whose row has the wrong shape
+        size_t from = 0;
+        size_t to = numCands;
+        if (level == 0) {
+            bool plain = rowShape(0, r) == firstShape;
+            bool transposed = rowShape(1, r) == firstShape;
+            from = plain ? 0 : NumColumnOrders;
+            to = transposed ? numCands : NumColumnOrders;
+        }
+        work += to > from ? to - from : 0;
+        for (size_t n = from; n < to; ++n) {
+            candidate c = cands[n];
+            const unsigned char* src = grid[c.transpose] + r * BoardSize;
+            const unsigned char* order = columns[c.order];
+            unsigned char row[BoardSize];
+            int cmp = haveMin ? 0 : -1;
+            for (int j = 0; j < BoardSize; ++j) {
+                int v = src[order[j]];
+                if (v == 0) {
+                    row[j] = BlankKey;
+                } else {
+                    if (c.label[v] == 0) {
+                        c.label[v] = ++c.labels;
+                    }
+                    row[j] = c.label[v];
+                }
+                if (cmp == 0 && row[j] != minRow[j]) {
+                    cmp = row[j] < minRow[j] ? -1 : 1;
+                    if (cmp > 0) {
+                        break;
+                    }
+                }
+            }
+            if (cmp > 0) {
+                continue;
+            }
+            if (cmp < 0) {
+                memcpy(minRow, row, BoardSize);
+                haveMin = improved = true;
+                ties.clear();
+                tieRows.clear();
+            }
+            ties.push_back(c);
+            tieRows.push_back(r);
+        }
+    }
+    if (ties.empty()) {
+        return;
+    }
+    memcpy(bestRow[level], minRow, BoardSize);
+    if (improved) {
+        bestDepth = level + 1;
+    }
+
+    // the ties come grouped by source row and transposition, go down each group
+    for (size_t a = 0; a < ties.size(); ) {
+        size_t b = a + 1;
+        while (b < ties.size() && tieRows[b] == tieRows[a] &&
+               ties[b].transpose == ties[a].transpose) {
+            ++b;
+        }
+        rowOrder[level] = tieRows[a];
+        search(level + 1, used | (1u << tieRows[a]), &ties[a], b - a);
+        a = b;
+    }
+}
+
+inline solutionCache::solutionCache(size_t capacity):
+    capacity(capacity), numHits(0), numMisses(0)
+{}
+
+// look up a solution and mark it as the most recently used
+inline bool solutionCache::find(const string& key, string& solution) {
+    lock_guard<mutex> guard(lock);
+    auto it = index.find(key);
+    if (it == index.end()) {
+        ++numMisses;
+        return false;
+    }
+    entries.splice(entries.begin(), entries, it->second);
+    solution = it->second->second;
+    ++numHits;
+    return true;
+}
+
+// add a solution, forgetting the least recently used one if the cache is full
+inline void solutionCache::insert(const string& key, const string& solution) {
+    lock_guard<mutex> guard(lock);
+    if (capacity == 0 || index.count(key)) {
+        return;
+    }
+    if (entries.size() >= capacity) {
+        index.erase(entries.back().first);
+        entries.pop_back();
+    }
+    entries.emplace_front(key, solution);
+    index[key] = entries.begin();
+}
+
+inline size_t solutionCache::size() {
+    lock_guard<mutex> guard(lock);
+    return entries.size();
+}
+
+inline long long solutionCache::hits() {
+    lock_guard<mutex> guard(lock);
+    return numHits;
+}
+
+inline long long solutionCache::misses() {
+    lock_guard<mutex> guard(lock);
+    return numMisses;
+}
+
+#endif	// BOARD_CANON
@@ -0,0 +1,664 @@
+/*
+This file contains the command-line mode of the solver.
+With arguments the program runs without the menu: it reads the named files
+(or standard input for "-" or no files at all) and runs the boards through
+the pipeline of pipeline.h, which reads, solves and writes them in chunks at
+the same time, writing each chunk to standard output as soon as it is done,
+so it can sit in a shell pipeline, under xargs or under a job scheduler.
+Files are memory-mapped; standard input is read in chunks that end early
+whenever no more input is waiting, so a slow producer still gets its
+answers one board at a time. With --generate it makes new puzzles
+instead, see generator.h, and writes them one per line. Binary corpus files
+(corpus.h) are read like text files, and --pack and --unpack convert between
+the two without solving anything; a board a corpus cannot hold is left out
+and the exit status is 1. --grade rates each board with the grader
+of grader.h instead of solving it, and --split gives each board all the
+threads in one search of its own (parallel.h) instead of a board to each
+thread. With --serve it stays up as a daemon
+instead and answers boards sent to a Unix domain socket, see server.h.
+*/
+
+#ifndef COMMAND_LINE
+#define COMMAND_LINE
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cstdlib>
+#include <cstring>
+#include "batch.h"
+#include "output.h"
+#include "puzzlefile.h"
+#include "generator.h"
+#include "store.h"
+#include "server.h"
+#include "pipeline.h"
+#include "parallel.h"
+
+using namespace std;
+
+const size_t CommandLineBlock = 64; // boards in one chunk of the pipeline, see pipeline.h
+
+// everything the command line can set
+struct commandLine {
+    vector<string> inputs; // files to read in order, "-" for standard input
+    int square = 3; // boards have squares of square by square cells
+    SolveEngine engine = Backtracking;
+    int numThreads = 1;
+    OutputFormat format = LineFormat;
+    long long limit = 2; // solutions to count up to with the count engine
+    long long maxBoards = -1; // stop after this many boards, -1 for no limit
+    bool summary = false; // print the totals to standard error at the end
+    long long generate = 0; // puzzles to generate instead of solving, 0 to solve
+    long long clues = 25; // clues each generated puzzle aims for
+    long long seed = 1; // seed of the generated puzzles
+    long long minGuesses = 0; // fewest guesses a generated puzzle may take to solve
+    long long maxGuesses = -1; // most guesses a generated puzzle may take, -1 for no limit
+    long long cacheSize = 0; // solutions the canonical-form cache holds, 0 for no cache
+    long long maxNodes = 0; // recursive calls each board may take, 0 for no limit
+    long long maxMillis = 0; // milliseconds each board may take, 0 for no limit
+    string storeName; // solution store to answer from and add to, empty for none
+    bool pack = false; // write the boards as a corpus instead of solving them
+    bool unpack = false; // write the boards as text instead of solving them
+    bool grade = false; // write the grade of each board instead of solving it
+    string serveSocket; // Unix domain socket to serve boards on instead, empty for none
+    bool unordered = false; // write each chunk as soon as it is solved, not in input order
+    bool split = false; // search one board at a time with all the threads, see parallel.h
+};
+
+// print how to use the command line
+inline void printUsage(ostream& out, const char* program) {
+    out << "Usage: " << program << " [options] [file ...]\n"
+        << "Solve every board in the files, or in standard input for - or no files.\n"
+        << "Boards are 81 characters (256 or 625 with --box 4 or 5), '.' for a blank,\n"
+        << "values above 9 as A, B, C and so on, whitespace ignored, 'Z' ends a file.\n"
+        << "  -b, --box N            squares of N by N cells: 3 (default), 4 or 5\n"
+        << "  -e, --engine ENGINE    backtrack (default), dlx (9x9 only) or count\n"
+        << "  -j, --threads N        worker threads (default 1)\n"
+        << "  -f, --format FORMAT    line (default), grid, json, or binary or corpus (9x9 only)\n"
+        << "  -l, --limit N          solutions the count engine stops at (default 2)\n"
+        << "  -n, --max-boards N     stop after N boards\n"
+        << "      --unordered        write results as soon as they are solved instead of in\n"
+        << "                         input order (line, grid or json; json keeps the index)\n"
+        << "      --split            search one board at a time with all the threads instead\n"
+        << "                         of a board to each thread, for a few hard boards\n"
+        << "                         (9x9 backtrack)\n"
+        << "      --max-nodes N      give up on a board after N recursive calls\n"
+        << "      --time-limit MS    give up on a board after MS milliseconds\n"
+        << "  -c, --cache N          remember N solutions and answer repeated boards, even\n"
+        << "                         relabelled or mirrored, without a search (9x9 backtrack)\n"
+        << "      --store FILE       answer boards solved by any earlier run from a solution\n"
+        << "                         store and add the new ones, created if missing (9x9)\n"
+        << "      --pack             write the boards as a binary corpus without solving them\n"
+        << "      --unpack           write the boards as text, one per line, without solving\n"
+        << "      --grade            write the difficulty grade of each board instead of its\n"
+        << "                         solution (line, grid or json)\n"
+        << "      --serve SOCKET     stay up and answer boards sent to a Unix domain socket,\n"
+        << "                         one per line, with one JSON line each, until killed\n"
+        << "  -s, --summary          print the totals to standard error\n"
+        << "  -g, --generate N       write N new 9x9 puzzles with one solution instead\n"
+        << "      --clues N          clues a generated puzzle aims for, 17 to 81 (default 25)\n"
+        << "      --seed N           seed of the generated puzzles (default 1)\n"
+        << "      --min-guesses N    fewest guesses a generated puzzle takes to solve, for\n"
+        << "                         harder puzzles (default 0)\n"
+        << "      --max-guesses N    most guesses a generated puzzle takes to solve, 0 for\n"
+        << "                         puzzles singles alone solve (default no limit)\n"
+        << "  -h, --help             print this help\n";
+}
+
+// parse a whole number of at least min, false if the text is not one
+inline bool parseNumber(const char* text, long long min, long long& n) {
+    char* end;
+    n = strtoll(text, &end, 10);
+    return *text != '\0' && *end == '\0' && n >= min;
+}
+
+// parse the arguments into options; false after printing an error or the help,
+// with status set to what the program should return
+inline bool parseCommandLine(int argc, char* argv[], commandLine& cmd, int& status) {
+    for (int k = 1; k < argc; ++k) {
+        string arg = argv[k];
+        if (arg == "-h" || arg == "--help") {
+            printUsage(cout, argv[0]);
+            status = 0;
+            return false;
+        }
+        if (arg == "-s" || arg == "--summary") {
+            cmd.summary = true;
+            continue;
+        }
+        if (arg == "--unordered") {
+            cmd.unordered = true;
+            continue;
+        }
+        if (arg == "--pack" || arg == "--unpack") {
+            cmd.pack = arg == "--pack";
+            cmd.unpack = arg == "--unpack";
+            continue;
+        }
+        if (arg == "--grade") {
+            cmd.grade = true;
+            continue;
+        }
+        if (arg == "--split") {
+            cmd.split = true;
+            continue;
+        }
+        if (arg == "-" || arg[0] != '-') {
+            cmd.inputs.push_back(arg);
+            continue;
+        }
+
+        // every other option takes a value
+        status = 2;
+        const char* withValue[] = {"-b", "--box", "-e", "--engine", "-j", "--threads",
+                                   "-f", "--format", "-l", "--limit", "-n", "--max-boards",
+                                   "-g", "--generate", "--clues", "--seed", "-c", "--cache", "--store",
+                                   "--serve", "--max-nodes", "--time-limit", "--min-guesses",
+                                   "--max-guesses"};
+        bool known = false;
+        for (const char* name : withValue) {
+            known = known || arg == name;
+        }
+        if (!known) {
+            cerr << argv[0] << ": unknown option " << arg << endl;
+            printUsage(cerr, argv[0]);
+            return false;
+        }
+        if (k + 1 >= argc) {
+            cerr << argv[0] << ": " << arg << " needs a value" << endl;
+            return false;
+        }
+        string val = argv[++k];
+        long long n;
+        bool ok = true;
+        if (arg == "-b" || arg == "--box") {
+            ok = parseNumber(val.c_str(), 3, n) && n <= 5;
+            cmd.square = n;
+        } else if (arg == "-e" || arg == "--engine") {
+            if (val == "backtrack") {
+                cmd.engine = Backtracking;
+            } else if (val == "dlx") {
+                cmd.engine = DancingLinks;
+            } else if (val == "count") {
+                cmd.engine = CountSolutions;
+            } else {
+                ok = false;
+            }
+        } else if (arg == "-f" || arg == "--format") {
+            if (val == "line") {
+                cmd.format = LineFormat;
+            } else if (val == "grid") {
+                cmd.format = GridFormat;
+            } else if (val == "json") {
+                cmd.format = JsonFormat;
+            } else if (val == "binary") {
+                cmd.format = BinaryFormat;
+            } else if (val == "corpus") {
+                cmd.format = CorpusFormat;
+            } else {
+                ok = false;
+            }
+        } else if (arg == "-j" || arg == "--threads") {
+            ok = parseNumber(val.c_str(), 1, n);
+            cmd.numThreads = n;
+        } else if (arg == "-l" || arg == "--limit") {
+            ok = parseNumber(val.c_str(), 1, cmd.limit);
+        } else if (arg == "-g" || arg == "--generate") {
+            ok = parseNumber(val.c_str(), 1, cmd.generate);
+        } else if (arg == "--clues") {
+            ok = parseNumber(val.c_str(), MinClues, cmd.clues) && cmd.clues <= 81;
+        } else if (arg == "--seed") {
+            ok = parseNumber(val.c_str(), 0, cmd.seed);
+        } else if (arg == "--min-guesses") {
+            ok = parseNumber(val.c_str(), 0, cmd.minGuesses);
+        } else if (arg == "--max-guesses") {
+            ok = parseNumber(val.c_str(), 0, cmd.maxGuesses);
+        } else if (arg == "-c" || arg == "--cache") {
+            ok = parseNumber(val.c_str(), 0, cmd.cacheSize);
+        } else if (arg == "--store") {
+            cmd.storeName = val;
+        } else if (arg == "--max-nodes") {
+            ok = parseNumber(val.c_str(), 1, cmd.maxNodes);
+        } else if (arg == "--time-limit") {
+            ok = parseNumber(val.c_str(), 1, cmd.maxMillis);
+        } else if (arg == "--serve") {
+            cmd.serveSocket = val;
+        } else {
+            ok = parseNumber(val.c_str(), 0, cmd.maxBoards);
+        }
+        if (!ok) {
+            cerr << argv[0] << ": invalid value " << val << " for " << arg << endl;
+            return false;
+        }
+    }
+    if (cmd.square != 3 && (cmd.engine == DancingLinks || cmd.format == BinaryFormat ||
+                            cmd.format == CorpusFormat || cmd.pack || cmd.unpack)) {
+        cerr << argv[0] << ": dlx, binary and corpus only work on 9x9 boards" << endl;
+        return false;
+    }
+    if (!cmd.storeName.empty() && (cmd.square != 3 || cmd.engine == CountSolutions)) {
+        cerr << argv[0] << ": the store only holds 9x9 boards solved by backtrack or dlx" << endl;
+        return false;
+    }
+    if (cmd.square != 3 && cmd.generate > 0) {
+        cerr << argv[0] << ": only 9x9 puzzles can be generated" << endl;
+        return false;
+    }
+    if (cmd.maxGuesses >= 0 && cmd.maxGuesses < cmd.minGuesses) {
+        cerr << argv[0] << ": --max-guesses is below --min-guesses" << endl;
+        return false;
+    }
+    if (cmd.unordered && (cmd.format == BinaryFormat || cmd.format == CorpusFormat ||
+                          cmd.pack || cmd.unpack)) {
+        cerr << argv[0] << ": binary and corpus records must stay in input order" << endl;
+        return false;
+    }
+    if (cmd.grade && (cmd.format == BinaryFormat || cmd.format == CorpusFormat ||
+                      cmd.pack || cmd.unpack || cmd.generate > 0)) {
+        cerr << argv[0] << ": --grade writes line, grid or json" << endl;
+        return false;
+    }
+    if (cmd.split && (cmd.square != 3 || cmd.engine != Backtracking || cmd.cacheSize > 0 ||
+                      cmd.pack || cmd.unpack || cmd.grade || cmd.generate > 0 ||
+                      !cmd.serveSocket.empty())) {
+        cerr << argv[0] << ": --split solves 9x9 boards with backtrack and no cache" << endl;
+        return false;
+    }
+    if (!cmd.serveSocket.empty() && (!cmd.inputs.empty() || cmd.generate > 0 || cmd.pack ||
+                                     cmd.unpack || cmd.grade)) {
+        cerr << argv[0] << ": --serve reads boards from its socket only" << endl;
+        return false;
+    }
+    if (cmd.inputs.empty()) {
+        cmd.inputs.push_back("-");
+    }
+    status = 0;
+    return true;
+}
+
+// read up to max boards of size characters from a stream into block,
+// stopping early once at least one board is read and no more input is
+// waiting; false at the end of the input or its 'Z' marker with nothing read
+inline bool readBlock(istream& in, vector<string>& block, size_t max, size_t size) {
+    streambuf* buf = in.rdbuf();
+    block.clear();
+    string cells;
+    while (block.size() < max) {
+        if (!block.empty() && cells.empty() && buf->in_avail() <= 0) {
+            break;
+        }
+        int ch = buf->sbumpc();
+        if (ch == EOF || ch == 'Z') {
+            in.setstate(ios::eofbit);
+            break;
+        }
+        if (isSpace(ch)) {
+            continue;
+        }
+        cells += char(ch);
+        if (cells.size() == size) {
+            block.push_back(cells);
+            cells.clear();
+        }
+    }
+    return !block.empty();
+}
+
+// write the puzzles --generate asks for, a block at a time, and return the
+// program's exit status
+inline int runGenerator(const commandLine& cmd) {
+    generatorOptions opts;
+    opts.clues = cmd.clues;
+    opts.minGuesses = cmd.minGuesses;
+    opts.maxGuesses = cmd.maxGuesses;
+    outputWriter out(cout);
+    long long missed = 0;
+    for (long long first = 0; first < cmd.generate; ) {
+        long long last = min(first + (long long)CommandLineBlock, cmd.generate);
+        vector<generatedPuzzle> puzzles = generatePuzzles(cmd.seed, first, last,
+                                                          cmd.numThreads, opts);
+        for (size_t k = 0; k < puzzles.size(); ++k) {
+            out.write(puzzles[k].puzzle.data(), puzzles[k].puzzle.size());
+            out.put('\n');
+            missed += !puzzles[k].met;
+        }
+        out.flush();
+        first = last;
+    }
+    if (cmd.summary) {
+        cerr << "Puzzles: " << cmd.generate << ", off target: " << missed << endl;
+    }
+    return 0;
+}
+
+// solve what the command line asks for and return the program's exit status
+inline int runCommandLine(int argc, char* argv[]) {
+    commandLine cmd;
+    int status;
+    if (!parseCommandLine(argc, argv, cmd, status)) {
+        return status;
+    }
+
+    ios::sync_with_stdio(false); // lets cin buffer, and tell readBlock what is waiting
+    if (cmd.generate > 0) {
+        return runGenerator(cmd);
+    }
+    solveOptions opts;
+    opts.select = MinRemaining;
+    opts.propagate = true;
+    opts.maxNodes = cmd.maxNodes;
+    opts.maxMillis = cmd.maxMillis;
+    if (cmd.engine == CountSolutions) {
+        opts.techniques = techniqueBit(LockedCandidates);
+    }
+
+    outputWriter out(cout);
+    solutionCache cache(cmd.cacheSize);
+    solutionCache* useCache = cmd.cacheSize > 0 ? &cache : nullptr;
+    puzzleStore store;
+    if (!cmd.storeName.empty()) {
+        try {
+            store.open(cmd.storeName, true);
+        } catch (fileOpenError&) {
+            // a store we may not write to still answers what it holds
+            try {
+                store.open(cmd.storeName);
+            } catch (baseException& ex) {
+                cerr << argv[0] << ": " << ex.what() << endl;
+                return 1;
+            }
+        } catch (baseException& ex) {
+            cerr << argv[0] << ": " << ex.what() << endl;
+            return 1;
+        }
+    }
+    if (!cmd.serveSocket.empty()) {
+        serverOptions server;
+        server.opts = opts;
+        server.engine = cmd.engine;
+        server.limit = cmd.limit;
+        server.cache = useCache;
+        server.store = cmd.storeName.empty() ? nullptr : &store;
+        try {
+            switch (cmd.square) {
+            case 4:
+                runServer<4>(cmd.serveSocket, server);
+                break;
+            case 5:
+                runServer<5>(cmd.serveSocket, server);
+                break;
+            default:
+                runServer<3>(cmd.serveSocket, server);
+            }
+        } catch (baseException& ex) {
+            cerr << argv[0] << ": " << ex.what() << endl;
+            return 1;
+        }
+        store.sync();
+        return 0;
+    }
+    atomic<long long> storeHits(0);
+    batchTotals totals;
+    long long gradeCounts[NumGrades] = {}; // boards of each grade with --grade
+    long long left = cmd.maxBoards < 0 ? -1 : cmd.maxBoards;
+    size_t numCells = cmd.square * cmd.square * cmd.square * cmd.square;
+
+    // one solver per pipeline worker for the size the command line picked,
+    // so a worker builds its board, engine and canonicalizer only once; with
+    // --split one worker hands each board to all the threads
+    int numWorkers = cmd.split ? 1 : max(1, cmd.numThreads);
+    vector<boardSolver<3>> solvers3;
+    vector<boardSolver<4>> solvers4;
+    vector<boardSolver<5>> solvers5;
+    auto makeSolvers = [&](auto& solvers) {
+        solvers.reserve(numWorkers);
+        for (int t = 0; t < numWorkers; ++t) {
+            solvers.emplace_back(opts, cmd.engine, cmd.limit, useCache);
+        }
+    };
+    if (!cmd.pack && !cmd.unpack) {
+        switch (cmd.square) {
+        case 4:
+            makeSolvers(solvers4);
+            break;
+        case 5:
+            makeSolvers(solvers5);
+            break;
+        default:
+            makeSolvers(solvers3);
+        }
+    }
+    // solve boards of one chunk a board at a time, each with all the threads;
+    // the parallel search keeps no statistics beyond its recursive calls
+    auto split = [&](auto record, size_t first, size_t last) {
+        vector<batchResult> results(last - first);
+        board b;
+        for (size_t k = first; k < last; ++k) {
+            batchResult& r = results[k - first];
+            const char* cells = record(k);
+            r.invalid = !isPlainBoard(cells);
+            if (r.invalid) {
+                r.solution.assign(cells, RecordSize);
+                continue;
+            }
+            b.initialize(cells);
+            r.solved = solveParallel(b, opts, cmd.numThreads, 2, r.recursiveCalls, r.aborted);
+            r.solutions = r.solved;
+            r.solution = b.toString();
+        }
+        return results;
+    };
+    // solve boards of one chunk with the solver of the worker running it
+    auto solve = [&](int worker, auto record, size_t first, size_t last) {
+        if (cmd.split) {
+            return split(record, first, last);
+        }
+        switch (cmd.square) {
+        case 4:
+            return solveBoards(solvers4[worker], record, first, last);
+        case 5:
+            return solveBoards(solvers5[worker], record, first, last);
+        }
+        return solveBoards(solvers3[worker], record, first, last);
+    };
+    // solve one chunk, taking the boards the store already holds from it and
+    // adding the rest once they are solved
+    auto solveStored = [&](int worker, auto record, size_t first, size_t last) {
+        if (cmd.storeName.empty()) {
+            return solve(worker, record, first, last);
+        }
+        vector<batchResult> results(last - first);
+        vector<size_t> missed;
+        for (size_t k = first; k < last; ++k) {
+            if (!store.find(record(k), results[k - first])) {
+                missed.push_back(k);
+            }
+        }
+        storeHits += results.size() - missed.size();
+        auto missing = [&](size_t k) { return record(missed[k]); };
+        vector<batchResult> solved = solve(worker, missing, 0, missed.size());
+        for (size_t m = 0; m < missed.size(); ++m) {
+            results[missed[m] - first] = solved[m];
+            store.insert(record(missed[m]), solved[m]);
+        }
+        return results;
+    };
+    // boards to take in the next chunk
+    auto blockSize = [&]() {
+        return left < 0 ? CommandLineBlock : min(CommandLineBlock, size_t(left));
+    };
+
+    // where the reader is: the input, and for a file the next board in it
+    size_t input = 0;
+    bool opened = false;
+    bool corpusInput = false;
+    puzzleFile file;
+    corpusFile corpus;
+    size_t position = 0;
+    string inputError; // why the reader stopped early, empty if it did not
+    // fill a chunk with the next boards of the inputs, false once they are
+    // all read, --max-boards is reached or a file cannot be read
+    auto read = [&](pipelineChunk& chunk) {
+        while (left != 0 && input < cmd.inputs.size()) {
+            const string& name = cmd.inputs[input];
+            if (name == "-") {
+                if (readBlock(cin, chunk.boards, blockSize(), numCells)) {
+                    left -= left < 0 ? 0 : chunk.boards.size();
+                    return true;
+                }
+                ++input;
+                continue;
+            }
+            if (!opened) {
+                try {
+                    corpusInput = isCorpusFile(name);
+                    if (corpusInput) {
+                        corpus.open(name);
+                    } else {
+                        file.open(name, numCells);
+                    }
+                } catch (baseException& ex) {
+                    inputError = ex.what();
+                    return false;
+                }
+                if (corpusInput && cmd.square != 3) {
+                    inputError = name + " holds 9x9 boards";
+                    return false;
+                }
+                opened = true;
+                position = 0;
+            }
+            size_t size = corpusInput ? corpus.size() : file.size();
+            if (position < size) {
+                // copy the boards out, the file is closed before they are written;
+                // a corpus is unpacked a chunk at a time
+                size_t last = min(position + blockSize(), size);
+                chunk.boards.resize(last - position);
+                char cells[RecordSize];
+                for (size_t k = position; k < last; ++k) {
+                    if (corpusInput) {
+                        corpus.board(k, cells);
+                        chunk.boards[k - position].assign(cells, RecordSize);
+                    } else {
+                        chunk.boards[k - position].assign(file.record(k), numCells);
+                    }
+                }
+                left -= left < 0 ? 0 : last - position;
+                position = last;
+                return true;
+            }
+            opened = false;
+            ++input;
+        }
+        return false;
+    };
+    // grade boards of one chunk with the solver of the worker running it
+    auto grade = [&](int worker, pipelineChunk& chunk) {
+        chunk.grades.resize(chunk.boards.size());
+        for (size_t k = 0; k < chunk.boards.size(); ++k) {
+            const char* cells = chunk.boards[k].c_str();
+            switch (cmd.square) {
+            case 4:
+                solvers4[worker].grade(cells, chunk.grades[k]);
+                break;
+            case 5:
+                solvers5[worker].grade(cells, chunk.grades[k]);
+                break;
+            default:
+                solvers3[worker].grade(cells, chunk.grades[k]);
+            }
+        }
+    };
+    // solve or grade a chunk, or leave it as it is for --pack and --unpack
+    auto work = [&](pipelineChunk& chunk, int worker) {
+        if (cmd.grade) {
+            grade(worker, chunk);
+        } else if (!cmd.pack && !cmd.unpack) {
+            auto record = [&](size_t k) { return chunk.boards[k].c_str(); };
+            chunk.results = solveStored(worker, record, 0, chunk.boards.size());
+        }
+    };
+    // write a chunk, solved, graded or converted, and flush it so the results stream out
+    auto write = [&](pipelineChunk& chunk) {
+        long long index = chunk.first;
+        for (size_t k = 0; k < chunk.boards.size(); ++k, ++index) {
+            const char* cells = chunk.boards[k].c_str();
+            if (cmd.unpack) {
+                out.write(cells, numCells);
+                out.put('\n');
+            } else if (cmd.pack) {
+                if (index == 0) {
+                    char header[CorpusHeaderSize];
+                    corpusHeader(false, header);
+                    out.write(header, CorpusHeaderSize);
+                }
+                unsigned char packed[PackedCells];
+                int size = corpusRecord(cells, false, nullptr, packed);
+                totals.numInvalid += size == 0;
+                out.write((const char*) packed, size);
+            } else if (cmd.grade) {
+                out.writeGrade(cmd.format, index, cells, numCells, chunk.grades[k]);
+                ++gradeCounts[chunk.grades[k].grade];
+            } else {
+                out.writeResult(cmd.format, index, cells, chunk.results[k]);
+            }
+        }
+        out.flush();
+        if (cmd.pack || cmd.unpack || cmd.grade) {
+            totals.numBoards += chunk.boards.size();
+            return;
+        }
+        batchTotals block = sumBatch(chunk.results);
+        totals.numBoards += block.numBoards;
+        totals.numSolved += block.numSolved;
+        totals.numAborted += block.numAborted;
+        totals.numInvalid += block.numInvalid;
+        totals.recursiveCalls += block.recursiveCalls;
+    };
+
+    runPipeline(read, work, write, numWorkers, !cmd.unordered);
+    if (!inputError.empty()) {
+        out.flush();
+        cerr << argv[0] << ": " << inputError << endl;
+        return 1;
+    }
+
+    if (cmd.unpack) {
+        out.write("Z\n", 2);
+        out.flush();
+    }
+    if (cmd.summary && cmd.grade) {
+        cerr << "Boards: " << totals.numBoards;
+        for (int g = 0; g < NumGrades; ++g) {
+            cerr << ", " << gradeName(Grade(g)) << ": " << gradeCounts[g];
+        }
+        cerr << endl;
+    } else if (cmd.summary) {
+        cerr << "Boards: " << totals.numBoards << ", solved: " << totals.numSolved
+             << ", recursive calls: " << totals.recursiveCalls;
+        if (cmd.maxNodes > 0 || cmd.maxMillis > 0) {
+            cerr << ", aborted: " << totals.numAborted;
+        }
+        if (totals.numInvalid > 0) {
+            cerr << ", invalid: " << totals.numInvalid;
+        }
+        if (useCache) {
+            cerr << ", cache hits: " << cache.hits();
+        }
+        if (!cmd.storeName.empty()) {
+            cerr << ", store hits: " << storeHits.load();
+        }
+        cerr << endl;
+    }
+    store.sync();
+    if ((cmd.pack || cmd.format == CorpusFormat) && totals.numInvalid > 0) {
+        // a corpus has no way to mark them, so it is short of those boards
+        cerr << argv[0] << ": left out " << totals.numInvalid
+             << " boards with a cell that is not '.' or 1 to 9" << endl;
+        return 1;
+    }
+    return 0;
+}
+
+#endif	// COMMAND_LINE
@@ -0,0 +1,207 @@
+/*
+This file contains the binary corpus format for 9x9 boards.
+A corpus is a header and then one fixed-size record per board: the board
+packed four bits a cell (see packCells), followed by its solution packed the
+same way if the header says the corpus has solutions. 41 or 82 bytes a board
+instead of 82 characters of text. Since every record has the same size, the
+index of a board's offset is arithmetic: board n starts at
+CorpusHeaderSize + n * recordSize, so a reader gets to any board in constant
+time and a byte range of the file maps straight to a range of boards. The
+number of boards is the size of the file past the header over the record
+size, so a corpus can be written to a pipe without going back to patch the
+header.
+*/
+
+#ifndef PUZZLE_CORPUS
+#define PUZZLE_CORPUS
+
+#include <string>
+#include <cstdint>
+#include <cstring>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "d_except.h"
+#include "puzzlefile.h"
+
+using namespace std;
+
+const char CorpusMagic[8] = {'S', 'U', 'D', 'O', 'C', 'R', 'P', '1'};
+const int CorpusHeaderSize = 16; // magic, then flags as 4 bytes low byte first, then 4 reserved
+const uint32_t CorpusSolutions = 1; // flag: every record has a solution after its board
+
+// return true if the bytes at the start of a file are a corpus header
+inline bool isCorpus(const char* data, size_t length) {
+    return length >= size_t(CorpusHeaderSize) && memcmp(data, CorpusMagic, sizeof(CorpusMagic)) == 0;
+}
+
+// check if a file starts with a corpus header, without mapping it
+inline bool isCorpusFile(const string& fileName) {
+    char header[CorpusHeaderSize];
+    int fd = ::open(fileName.c_str(), O_RDONLY);
+    bool corpus = fd >= 0 && pread(fd, header, CorpusHeaderSize, 0) == CorpusHeaderSize &&
+                  isCorpus(header, CorpusHeaderSize);
+    if (fd >= 0) {
+        ::close(fd);
+    }
+    return corpus;
+}
+
+// fill in the CorpusHeaderSize bytes of a corpus header
+inline void corpusHeader(bool withSolutions, char* header) {
+    memset(header, 0, CorpusHeaderSize);
+    memcpy(header, CorpusMagic, sizeof(CorpusMagic));
+    header[8] = withSolutions ? CorpusSolutions : 0;
+}
+
+// fill in one record of a corpus and return its size: the board alone, or
+// with withSolutions the board and then its solution, blanks if solution is
+// nullptr because the board has none. A board that cannot be packed as it
+// is, see packable, gets no record and 0
+inline int corpusRecord(const char* cells, bool withSolutions, const char* solution,
+                        unsigned char* record) {
+    if (!packable(cells)) {
+        return 0;
+    }
+    packCells(cells, record);
+    if (!withSolutions) {
+        return PackedCells;
+    }
+    if (solution) {
+        packCells(solution, record + PackedCells);
+    } else {
+        memset(record + PackedCells, 0, PackedCells);
+    }
+    return 2 * PackedCells;
+}
+
+class corpusFile {
+public:
+    corpusFile(); // constructor, no file open
+    ~corpusFile(); // unmap the file
+    void open(const string& fileName); // map a corpus, throws fileOpenError or fileError
+    void close(); // unmap the file
+    int size() const; // number of boards
+    bool hasSolutions() const; // true if the records hold solutions
+    void board(int n, char* cells) const; // unpack board n into 81 characters
+    bool solution(int n, char* cells) const; // unpack the solution of board n, false if none
+    size_t offset(int n) const; // byte offset in the file where board n starts
+    int boardAt(size_t byteOffset) const; // first board starting at or after a byte offset
+    size_t bytes() const; // size of the file in bytes
+
+private:
+    const unsigned char* data; // the mapping, nullptr when no file is open
+    size_t length; // bytes mapped
+    int recordSize; // bytes in one record
+    int numBoards;
+    bool solutions;
+
+    const unsigned char* record(int n) const; // start of record n, throws indexRangeError
+
+    corpusFile(const corpusFile&); // a mapping has one owner
+    corpusFile& operator=(const corpusFile&);
+};
+
+inline corpusFile::corpusFile() :
+    data(nullptr), length(0), recordSize(PackedCells), numBoards(0), solutions(false) {
+}
+
+inline corpusFile::~corpusFile() {
+    close();
+}
+
+// map a corpus; the boards are not touched until they are asked for
+inline void corpusFile::open(const string& fileName) {
+    close();
+    int fd = ::open(fileName.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw fileOpenError(fileName);
+    }
+    struct stat info;
+    if (fstat(fd, &info) < 0) {
+        ::close(fd);
+        throw fileOpenError(fileName);
+    }
+    char header[CorpusHeaderSize];
+    if (pread(fd, header, CorpusHeaderSize, 0) != CorpusHeaderSize ||
+        !isCorpus(header, CorpusHeaderSize)) {
+        ::close(fd);
+        throw fileError("corpusFile: " + fileName + " is not a puzzle corpus");
+    }
+    length = info.st_size;
+    void* map = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd); // the mapping stays valid without the descriptor
+    if (map == MAP_FAILED) {
+        length = 0;
+        throw fileOpenError(fileName);
+    }
+    data = (const unsigned char*) map;
+    solutions = data[8] & CorpusSolutions;
+    recordSize = solutions ? 2 * PackedCells : PackedCells;
+    numBoards = (length - CorpusHeaderSize) / recordSize; // a partial record at the end is ignored
+}
+
+// unmap the file
+inline void corpusFile::close() {
+    if (data) {
+        munmap((void*) data, length);
+    }
+    data = nullptr;
+    length = 0;
+    numBoards = 0;
+    solutions = false;
+}
+
+// get the number of boards in the corpus
+inline int corpusFile::size() const {
+    return numBoards;
+}
+
+// check if the records hold solutions
+inline bool corpusFile::hasSolutions() const {
+    return solutions;
+}
+
+// get the start of record n
+inline const unsigned char* corpusFile::record(int n) const {
+    if (n < 0 || n >= numBoards) {
+        throw indexRangeError("corpusFile: invalid board number", n, numBoards);
+    }
+    return data + CorpusHeaderSize + size_t(n) * recordSize;
+}
+
+// unpack board n into 81 characters in file format
+inline void corpusFile::board(int n, char* cells) const {
+    unpackCells(record(n), cells);
+}
+
+// unpack the solution of board n, false if the corpus has no solutions
+inline bool corpusFile::solution(int n, char* cells) const {
+    if (!solutions) {
+        return false;
+    }
+    unpackCells(record(n) + PackedCells, cells);
+    return true;
+}
+
+// get the byte offset in the file where board n starts
+inline size_t corpusFile::offset(int n) const {
+    return record(n) - data;
+}
+
+// get the first board that starts at or after a byte offset, size() if none
+inline int corpusFile::boardAt(size_t byteOffset) const {
+    if (byteOffset <= size_t(CorpusHeaderSize)) {
+        return 0;
+    }
+    size_t n = (byteOffset - CorpusHeaderSize + recordSize - 1) / recordSize;
+    return n < size_t(numBoards) ? n : numBoards;
+}
+
+// get the size of the file in bytes
+inline size_t corpusFile::bytes() const {
+    return length;
+}
+
+#endif	// PUZZLE_CORPUS
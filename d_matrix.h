@@ -3,29 +3,78 @@
 
 #include <iostream>
 #include <vector>
+#include <iterator>
 
 #include "d_except.h"
 
 using namespace std;
 
-template <typename T>
+// bounds-check policies for matrix. with checkedIndex, a row or column
+// index out of range throws the indexRangeError exception; with
+// uncheckedIndex the checks are compiled out
+struct checkedIndex
+{
+	static const bool check = true;
+};
+
+struct uncheckedIndex
+{
+	static const bool check = false;
+};
+
+// debug builds check every index, release builds (NDEBUG) do not
+#ifdef NDEBUG
+typedef uncheckedIndex defaultIndexPolicy;
+#else
+typedef checkedIndex defaultIndexPolicy;
+#endif
+
+// one row of a matrix, returned by matrix::operator[] so that
+// mat[i][j] works. Ptr is T* or const T*
+template <typename Ptr, typename IndexPolicy>
+class matrixRow
+{
+	public:
+		matrixRow(Ptr rowStart, int numCols);
+			// constructor. rowStart is the first element of the row
+
+		typename iterator_traits<Ptr>::reference operator[] (int j) const;
+			// index operator.
+			// Precondition: 0 <= j < number of columns. with checkedIndex,
+			// a violation of this precondition throws the
+			// indexRangeError exception
+
+		int size() const;
+			// return number of columns
+
+	private:
+		Ptr row;
+			// first element of the row
+		int nCols;
+			// number of columns
+};
+
+template <typename T, typename IndexPolicy = defaultIndexPolicy>
 class matrix
 {
 	public:
+		typedef matrixRow<T*, IndexPolicy> row;
+		typedef matrixRow<const T*, IndexPolicy> constRow;
+
 		matrix(int numRows = 1, int numCols = 1, const T& initVal = T());
 			// constructor.
 			// Postcondition: create array having numRows x numCols elements
 			// all of whose elements have value initVal
 
-		vector<T>& operator[] (int i);
+		row operator[] (int i);
 			// index operator.
-			// Precondition: 0 <= i < nRows. a violation of this
-			// precondition throws the indexRangeError exception.
+			// Precondition: 0 <= i < nRows. with checkedIndex, a violation
+			// of this precondition throws the indexRangeError exception.
 			// Postcondition: if the operator is used on the left-hand
-			// side of an assignment statement, an element of row i 
+			// side of an assignment statement, an element of row i
 			// is changed
 
-		const vector<T>& operator[](int i) const;
+		constRow operator[](int i) const;
 			// version for constant objects
 
       int rows() const;
@@ -36,78 +85,103 @@ class matrix
       void resize(int numRows, int numCols);
 			// modify the matrix size.
 			// Postcondition: the matrix has size numRows x numCols.
+			// elements that are in both sizes keep their values,
 			// any new elements are filled with the default value of type T
 
 	private:
       int nRows, nCols;
 			// number of rows and columns
 
-      vector<vector<T> > mat;
-			// matrix is implemented as nRows vectors (rows),
-			// each having nCols elements (columns)
+      vector<T> mat;
+			// matrix is implemented as one buffer of nRows * nCols
+			// elements, row after row (so T cannot be bool, whose
+			// vector has no buffer to point into)
 };
 
-template <typename T>
-matrix<T>::matrix(int numRows, int numCols, const T& initVal):
+template <typename Ptr, typename IndexPolicy>
+inline matrixRow<Ptr, IndexPolicy>::matrixRow(Ptr rowStart, int numCols):
+	row(rowStart), nCols(numCols)
+{}
+
+template <typename Ptr, typename IndexPolicy>
+inline typename iterator_traits<Ptr>::reference
+matrixRow<Ptr, IndexPolicy>::operator[] (int j) const
+{
+	if (IndexPolicy::check && (j < 0 || j >= nCols))
+		throw indexRangeError(
+			"matrix: invalid column index", j, nCols);
+
+   return row[j];
+}
+
+template <typename Ptr, typename IndexPolicy>
+inline int matrixRow<Ptr, IndexPolicy>::size() const
+{
+   return nCols;
+}
+
+template <typename T, typename IndexPolicy>
+matrix<T, IndexPolicy>::matrix(int numRows, int numCols, const T& initVal):
 	nRows(numRows), nCols(numCols),
-	mat(numRows, vector<T>(numCols,initVal))
+	mat(numRows * numCols, initVal)
 {}
 
 // non-constant version. provides general access to matrix
 // elements
-template <typename T>
-vector<T>& matrix<T>::operator[] (int i)
+template <typename T, typename IndexPolicy>
+inline typename matrix<T, IndexPolicy>::row matrix<T, IndexPolicy>::operator[] (int i)
 {
-	if (i < 0 || i >= nRows)
+	if (IndexPolicy::check && (i < 0 || i >= nRows))
 		throw indexRangeError(
 			"matrix: invalid row index", i, nRows);
 
-   return mat[i];
+   return row(mat.data() + i * nCols, nCols);
 }
 
 // constant version.  can be used with a constant object.
 // does not allow modification of a matrix element
-template <typename T>
-const vector<T>& matrix<T>::operator[] (int i) const
+template <typename T, typename IndexPolicy>
+inline typename matrix<T, IndexPolicy>::constRow matrix<T, IndexPolicy>::operator[] (int i) const
 {
-	if (i < 0 || i >= nRows)
+	if (IndexPolicy::check && (i < 0 || i >= nRows))
 		throw indexRangeError(
 			"matrix: invalid row index", i, nRows);
 
-   return mat[i];
+   return constRow(mat.data() + i * nCols, nCols);
 }
 
-template <typename T>
-int matrix<T>::rows() const
+template <typename T, typename IndexPolicy>
+int matrix<T, IndexPolicy>::rows() const
 {
    return nRows;
 }
 
-template <typename T>
-int matrix<T>::cols() const
+template <typename T, typename IndexPolicy>
+int matrix<T, IndexPolicy>::cols() const
 {
    return nCols;
 }
 
-template <typename T>
-void matrix<T>::resize(int numRows, int numCols)
+template <typename T, typename IndexPolicy>
+void matrix<T, IndexPolicy>::resize(int numRows, int numCols)
 {
-   int i;
-   
+   int i, j;
+
    // handle case of no size change with a return
    if (numRows == nRows && numCols == nCols)
       return;
 
+	// copy the elements the old and new sizes share into a new
+	// buffer, every other element gets the default value
+	vector<T> newMat(numRows * numCols);
+	for (i=0; i < nRows && i < numRows; i++)
+		for (j=0; j < nCols && j < numCols; j++)
+			newMat[i * numCols + j] = mat[i * nCols + j];
+
 	// assign the new matrix size
 	nRows = numRows;
 	nCols = numCols;
-
-	// resize to nRows rows
-	mat.resize(nRows);
-
-	// resize each row to have nCols columns
-	for (i=0; i < nRows; i++)
-		mat[i].resize(nCols);
+	mat.swap(newMat);
 }
 
 #endif	// MATRIX_CLASS
@@ -0,0 +1,351 @@
+/*
+This file contains the Dancing Links solving engine.
+The puzzle is modeled as an exact-cover problem with one column per constraint
+(every cell holds a value, every row, column and square holds every value once)
+and one row per possible placement of a value in a cell. Algorithm X then picks
+placements that cover every column exactly once. All nodes live in one array
+inside the object, so solving never allocates.
+*/
+
+#ifndef DLX_CLASS
+#define DLX_CLASS
+
+#include <iostream>
+#include <fstream>
+#include <cstdint>
+#include "board.h"
+
+using namespace std;
+
+const int DlxCells = BoardSize * BoardSize;
+const int DlxColumns = 4 * DlxCells; // constraint columns, 324 for a 9x9 board
+const int DlxRows = DlxCells * BoardSize; // placements, one per cell and value
+const int DlxRoot = DlxColumns; // header node that links the uncovered columns
+const int DlxNodes = DlxColumns + 1 + 4 * DlxRows; // headers, root and 4 nodes per placement
+
+typedef uint16_t DlxIndex; // index of a node in the arena
+
+class dlx {
+public:
+    dlx(); // constructor, builds the full exact-cover matrix once
+    void clear(); // clear the board
+    void initialize(ifstream& fin); // initialize the board with values from each file
+    void initialize(const char* cells); // initialize the board from 81 characters
+    solveStats solve(); // solve the board with Algorithm X and return what it took
+    long long countSolutions(long long limit); // count solutions, stopping once limit are found
+    long long getRecursiveCalls(); // recursive calls made by the last solve or count
+    const solveStats& getStats(); // statistics of the last solve or count
+    ValueType getCell(int i, int j); // get the value of a cell
+    void copyTo(board& b); // load the current grid into a board, e.g. to print it
+    void setOptions(const solveOptions& opts); // only the stop flag and budgets apply
+
+private:
+    struct node {
+        DlxIndex left, right, up, down; // neighbours in the row and column lists
+        DlxIndex column; // header of the column the node belongs to
+        DlxIndex row; // placement the node belongs to
+    };
+
+    node nodes[DlxNodes]; // the whole matrix, headers first, then 4 nodes per placement
+    DlxIndex size[DlxColumns]; // nodes still linked into each column
+    DlxIndex firstNode[DlxRows]; // first of the 4 nodes of each placement
+    DlxIndex givens[DlxCells]; // placements covered by initialize, in order
+    int numGivens; // number of entries in givens
+    DlxIndex chosen[DlxCells]; // placements picked by the search, one per level
+    ValueType value[DlxCells]; // current grid, Blank where nothing is placed
+    bool consistent; // false if the givens already conflict with each other
+    long long solutions; // solutions found by the current search
+    long long solutionLimit; // the search stops once it has found this many
+    long long recursiveCalls; // count the number of recursive calls
+    solveStats stats; // what the current search has done, see CollectStats
+    solveOptions options; // the stop flag and budgets of every search
+    searchBudget budget; // the same for the current search
+
+    void cover(int c); // unlink a column and every row that meets it
+    void uncover(int c); // relink a column, the exact reverse of cover
+    void coverRow(int r); // cover every column a placement meets
+    void uncoverRow(int r); // undo coverRow
+    void search(int depth); // recursive Algorithm X search
+};
+
+// return the placement index for value val in cell i,j
+inline int dlxRow(int i, int j, ValueType val) {
+    return ((i - 1) * BoardSize + (j - 1)) * BoardSize + (val - MinValue);
+}
+
+inline dlx::dlx() {
+    // column headers form a circular list through the root
+    for (int c = 0; c <= DlxColumns; ++c) {
+        nodes[c].left = c == 0 ? DlxRoot : c - 1;
+        nodes[c].right = c == DlxRoot ? 0 : c + 1;
+        nodes[c].up = nodes[c].down = c;
+        nodes[c].column = c;
+        nodes[c].row = 0;
+    }
+    for (int c = 0; c < DlxColumns; ++c) {
+        size[c] = 0;
+    }
+
+    int next = DlxColumns + 1;
+    for (int i = 1; i <= BoardSize; ++i) {
+        for (int j = 1; j <= BoardSize; ++j) {
+            for (ValueType val = MinValue; val <= MaxValue; ++val) {
+                int r = dlxRow(i, j, val);
+                int v = val - MinValue;
+                int cols[4] = {
+                    (i - 1) * BoardSize + (j - 1), // cell i,j is filled
+                    DlxCells + (i - 1) * BoardSize + v, // row i holds val
+                    2 * DlxCells + (j - 1) * BoardSize + v, // column j holds val
+                    3 * DlxCells + (squareNumber(i, j) - 1) * BoardSize + v // square holds val
+                };
+                firstNode[r] = next;
+                for (int k = 0; k < 4; ++k) {
+                    int n = next + k;
+                    int c = cols[k];
+                    // append to the bottom of the column
+                    nodes[n].column = c;
+                    nodes[n].row = r;
+                    nodes[n].up = nodes[c].up;
+                    nodes[n].down = c;
+                    nodes[nodes[c].up].down = n;
+                    nodes[c].up = n;
+                    ++size[c];
+                    // the 4 nodes of a placement form their own circular list
+                    nodes[n].left = next + (k + 3) % 4;
+                    nodes[n].right = next + (k + 1) % 4;
+                }
+                next += 4;
+            }
+        }
+    }
+
+    numGivens = 0;
+    clear();
+}
+
+// clear the board, restoring the full matrix
+inline void dlx::clear() {
+    // uncover the givens in the reverse order they were covered
+    while (numGivens > 0) {
+        uncoverRow(givens[--numGivens]);
+    }
+    for (int k = 0; k < DlxCells; ++k) {
+        value[k] = Blank;
+    }
+    consistent = true;
+    solutions = 0;
+    recursiveCalls = 0;
+}
+
+// initialize the board with values from a file, in the format board::initialize reads
+inline void dlx::initialize(ifstream& fin) {
+    char cells[DlxCells];
+    for (int k = 0; k < DlxCells; ++k) {
+        fin >> cells[k];
+    }
+    initialize(cells);
+}
+
+// initialize the board from 81 characters, row by row, '.' for a blank cell
+inline void dlx::initialize(const char* cells) {
+    clear();
+
+    for (int i = 1; i <= BoardSize; ++i) {
+        for (int j = 1; j <= BoardSize; ++j) {
+            ValueType val = charValue(*cells++);
+            if (val == Blank) {
+                continue;
+            }
+            // a character that is not a value of a 9x9 board can never be
+            // part of a solution; the cell stays blank
+            if (val < 1 || val > BoardSize) {
+                consistent = false;
+                continue;
+            }
+            value[(i - 1) * BoardSize + (j - 1)] = val;
+            int r = dlxRow(i, j, val);
+            // a given whose constraints are already covered repeats a value
+            // in its row, column or square
+            bool free = true;
+            int n = firstNode[r];
+            do {
+                int c = nodes[n].column;
+                free = free && nodes[nodes[c].left].right == c;
+                n = nodes[n].right;
+            } while (n != firstNode[r]);
+            if (free) {
+                coverRow(r);
+                givens[numGivens++] = r;
+            } else {
+                consistent = false;
+            }
+        }
+    }
+}
+
+// get the value of a cell
+inline ValueType dlx::getCell(int i, int j) {
+    if (i < 1 || i > BoardSize || j < 1 || j > BoardSize) {
+        throw rangeError("getCell: invalid index");
+    }
+    return value[(i - 1) * BoardSize + (j - 1)];
+}
+
+// load the current grid into a board
+inline void dlx::copyTo(board& b) {
+    b.clear();
+    for (int i = 1; i <= BoardSize; ++i) {
+        for (int j = 1; j <= BoardSize; ++j) {
+            if (getCell(i, j) != Blank) {
+                b.setCell(i, j, getCell(i, j));
+            }
+        }
+    }
+}
+
+// unlink a column and every row that meets it
+inline void dlx::cover(int c) {
+    nodes[nodes[c].right].left = nodes[c].left;
+    nodes[nodes[c].left].right = nodes[c].right;
+    for (int i = nodes[c].down; i != c; i = nodes[i].down) {
+        for (int j = nodes[i].right; j != i; j = nodes[j].right) {
+            nodes[nodes[j].down].up = nodes[j].up;
+            nodes[nodes[j].up].down = nodes[j].down;
+            --size[nodes[j].column];
+        }
+    }
+}
+
+// relink a column, the exact reverse of cover
+inline void dlx::uncover(int c) {
+    for (int i = nodes[c].up; i != c; i = nodes[i].up) {
+        for (int j = nodes[i].left; j != i; j = nodes[j].left) {
+            ++size[nodes[j].column];
+            nodes[nodes[j].down].up = j;
+            nodes[nodes[j].up].down = j;
+        }
+    }
+    nodes[nodes[c].right].left = c;
+    nodes[nodes[c].left].right = c;
+}
+
+// cover every column a placement meets
+inline void dlx::coverRow(int r) {
+    int n = firstNode[r];
+    do {
+        cover(nodes[n].column);
+        n = nodes[n].right;
+    } while (n != firstNode[r]);
+}
+
+// undo coverRow
+inline void dlx::uncoverRow(int r) {
+    int n = nodes[firstNode[r]].left;
+    do {
+        uncover(nodes[n].column);
+        n = nodes[n].left;
+    } while (n != nodes[firstNode[r]].left);
+}
+
+// solve the board with Algorithm X and return the statistics of the search
+inline solveStats dlx::solve() {
+    countSolutions(1);
+    return stats;
+}
+
+// count the solutions of the board, stopping as soon as limit have been found;
+// the grid holds the last solution found
+inline long long dlx::countSolutions(long long limit) {
+    recursiveCalls = 0;
+    solutions = 0;
+    solutionLimit = limit;
+    stats.guesses = stats.backtracks = 0;
+    stats.maxDepth = 0;
+    if (CollectStats) {
+        // every placement covers a cell column, so a search is at most DlxCells deep
+        stats.depth.assign(DlxCells + 1, 0);
+        stats.fanout.assign(BoardSize + 1, 0);
+    }
+    budget.start(options);
+    if (consistent) {
+        search(0);
+    }
+    budget.finish(recursiveCalls);
+    stats.solved = solutions > 0;
+    stats.aborted = budget.aborted();
+    stats.nodes = recursiveCalls;
+    return solutions;
+}
+
+// set the stop flag and the budgets of the next searches; the rest of the
+// options are for board's search
+inline void dlx::setOptions(const solveOptions& opts) {
+    options = opts;
+}
+
+// get the number of recursive calls made by the last solve or count
+inline long long dlx::getRecursiveCalls() {
+    return recursiveCalls;
+}
+
+// get the statistics of the last solve or count; depth counts chosen
+// placements, givens not included, and fanout the rows of each branching column
+inline const solveStats& dlx::getStats() {
+    return stats;
+}
+
+// recursive Algorithm X search, the matrix is fully restored when it returns
+inline void dlx::search(int depth) {
+    if (budget.exceeded(recursiveCalls)) {
+        return;
+    }
+    ++recursiveCalls;
+    if (CollectStats) {
+        ++stats.depth[depth];
+        stats.maxDepth = max(stats.maxDepth, depth);
+    }
+
+    if (nodes[DlxRoot].right == DlxRoot) {
+        // every constraint is covered, write the placements into the grid
+        for (int k = 0; k < depth; ++k) {
+            int r = chosen[k];
+            value[r / BoardSize] = r % BoardSize + MinValue;
+        }
+        ++solutions;
+        return;
+    }
+
+    // branch on the column with the fewest rows left
+    int c = nodes[DlxRoot].right;
+    for (int k = nodes[c].right; k != DlxRoot && size[c] > 1; k = nodes[k].right) {
+        if (size[k] < size[c]) {
+            c = k;
+        }
+    }
+    if (size[c] == 0) {
+        return;
+    }
+
+    if (CollectStats) {
+        ++stats.fanout[size[c]];
+    }
+    cover(c);
+    for (int r = nodes[c].down; r != c && solutions < solutionLimit && !budget.aborted();
+         r = nodes[r].down) {
+        chosen[depth] = nodes[r].row;
+        for (int j = nodes[r].right; j != r; j = nodes[j].right) {
+            cover(nodes[j].column);
+        }
+        search(depth + 1);
+        if (CollectStats) {
+            ++stats.guesses;
+            stats.backtracks += solutions < solutionLimit;
+        }
+        for (int j = nodes[r].left; j != r; j = nodes[j].left) {
+            uncover(nodes[j].column);
+        }
+    }
+    uncover(c);
+}
+
+#endif	// DLX_CLASS
@@ -0,0 +1,195 @@
+/*
+This file contains the puzzle generator.
+A puzzle starts as a random solved grid: the three squares on the diagonal
+share no row, column or square, so they are filled with random shuffles and
+the solver completes the rest, then a random symmetry from transform.h
+mixes the result. Clues are then taken away in random order, and a clue
+stays gone only if the puzzle still has one solution. Since the solution is
+known, that check is a single search with the removed value forbidden in
+its cell: any solution it finds is a second one.
+
+Puzzle k of a run is made from a generator seeded with the run's seed and k
+alone, so the same seed gives the same puzzles on any number of threads.
+Difficulty is the number of guesses the solver needs with minimum remaining
+values and singles propagation, 0 for a puzzle singles alone solve. It is
+counted from the recursive calls, one per guess after the first, so it does
+not need the statistics of SUDOKU_STATS. Random
+grids seldom thin out below about 21 clues, so lower targets take many
+attempts and 17 is only reached by luck; a puzzle that misses its targets
+after maxAttempts grids is the closest attempt, with met set to false.
+*/
+
+#ifndef PUZZLE_GENERATOR
+#define PUZZLE_GENERATOR
+
+#include <string>
+#include <vector>
+#include <random>
+#include <algorithm>
+#include <thread>
+#include <atomic>
+#include <cstdint>
+#include "board.h"
+#include "transform.h"
+
+using namespace std;
+
+const int MinClues = 17; // no 9x9 puzzle with fewer clues has one solution
+
+// what the generator aims for
+struct generatorOptions {
+    int clues = 25; // clues to stop at, MinClues to 81
+    long long minGuesses = 0; // fewest guesses the solver may need
+    long long maxGuesses = -1; // most guesses the solver may need, -1 for no limit
+    int maxAttempts = 100; // solved grids to try per puzzle before taking the closest
+    bool symmetric = false; // remove clues in pairs that mirror through the centre
+};
+
+// one generated puzzle
+struct generatedPuzzle {
+    string puzzle; // 81 characters in file format
+    string solution; // its only solution
+    int clues; // values given in the puzzle
+    long long guesses; // guesses the solver needs, see the comment at the top
+    int attempts; // solved grids it took
+    bool met; // false if no attempt reached both targets
+};
+
+// return a random solved grid as 81 characters
+template <typename Rng>
+string randomGrid(board& b, Rng& rng) {
+    string cells(BoardSize * BoardSize, '.');
+    for (int s = 0; s < SquareSize; ++s) {
+        char values[BoardSize];
+        for (int v = 0; v < BoardSize; ++v) {
+            values[v] = '0' + MinValue + v;
+        }
+        shuffle(values, values + BoardSize, rng);
+        for (int k = 0; k < BoardSize; ++k) {
+            int i = s * SquareSize + k / SquareSize;
+            int j = s * SquareSize + k % SquareSize;
+            cells[i * BoardSize + j] = values[k];
+        }
+    }
+    b.initialize(cells.c_str());
+    b.search(); // diagonal squares never conflict, so this always succeeds
+    return applyTransform(randomTransform(rng), b.toString().c_str());
+}
+
+// true if the puzzle, whose only solution before clue was removed is
+// solution, has no solution with a different value at clue
+inline bool stillUnique(board& b, const string& puzzle, const string& solution, int clue) {
+    b.initialize(puzzle.c_str());
+    b.forbid(clue / BoardSize + 1, clue % BoardSize + 1, solution[clue] - '0');
+    return !b.search();
+}
+
+// make puzzle index of the run with the given seed; b is scratch space and
+// gets its options set here
+inline generatedPuzzle generatePuzzle(uint64_t seed, uint64_t index,
+                                      const generatorOptions& opts, board& b) {
+    seed_seq seq = {uint32_t(seed), uint32_t(seed >> 32), uint32_t(index), uint32_t(index >> 32)};
+    mt19937 rng(seq);
+    solveOptions search;
+    search.select = MinRemaining;
+    search.propagate = true;
+    b.setOptions(search);
+    const int NumCells = BoardSize * BoardSize;
+    int target = max(opts.clues, MinClues);
+
+    generatedPuzzle best;
+    best.clues = NumCells + 1;
+    best.met = false;
+    bool bestInRange = false;
+    for (int attempt = 1; attempt <= max(opts.maxAttempts, 1); ++attempt) {
+        string solution = randomGrid(b, rng);
+        string puzzle = solution;
+        int order[NumCells];
+        for (int k = 0; k < NumCells; ++k) {
+            order[k] = k;
+        }
+        shuffle(order, order + NumCells, rng);
+
+        int clues = NumCells;
+        for (int k = 0; k < NumCells && clues > target; ++k) {
+            int cell = order[k];
+            int mirror = NumCells - 1 - cell;
+            if (puzzle[cell] == '.' || (opts.symmetric && mirror < cell)) {
+                continue;
+            }
+            bool pair = opts.symmetric && mirror != cell;
+            if (pair && clues - 2 < target) {
+                continue;
+            }
+            puzzle[cell] = '.';
+            if (pair) {
+                puzzle[mirror] = '.';
+            }
+            // any second solution differs from the first in a removed clue
+            if (stillUnique(b, puzzle, solution, cell) &&
+                (!pair || stillUnique(b, puzzle, solution, mirror))) {
+                clues -= pair ? 2 : 1;
+            } else {
+                puzzle[cell] = solution[cell];
+                if (pair) {
+                    puzzle[mirror] = solution[mirror];
+                }
+            }
+        }
+
+        b.initialize(puzzle.c_str());
+        b.search();
+        long long guesses = b.getRecursiveCalls() - 1; // every call but the first follows a guess
+        bool inRange = guesses >= opts.minGuesses &&
+                       (opts.maxGuesses < 0 || guesses <= opts.maxGuesses);
+        // keep the attempt nearest the targets: difficulty first, then clues
+        if (best.clues > NumCells || inRange > bestInRange ||
+            (inRange == bestInRange && clues < best.clues)) {
+            best.puzzle = puzzle;
+            best.solution = solution;
+            best.clues = clues;
+            best.guesses = guesses;
+            bestInRange = inRange;
+        }
+        best.attempts = attempt;
+        best.met = inRange && clues <= target;
+        if (best.met) {
+            break;
+        }
+    }
+    return best;
+}
+
+// make puzzles first to last - 1 of the run with the given seed on
+// numThreads workers, returned in index order
+inline vector<generatedPuzzle> generatePuzzles(uint64_t seed, size_t first, size_t last,
+                                               int numThreads, const generatorOptions& opts) {
+    vector<generatedPuzzle> puzzles(last > first ? last - first : 0);
+    atomic<size_t> next(0);
+
+    auto worker = [&]() {
+        board b;
+        while (true) {
+            size_t k = next.fetch_add(1); // a puzzle costs far more than the counter
+            if (k >= puzzles.size()) {
+                return;
+            }
+            puzzles[k] = generatePuzzle(seed, first + k, opts, b);
+        }
+    };
+
+    if (numThreads < 1) {
+        numThreads = 1;
+    }
+    vector<thread> pool;
+    for (int t = 1; t < numThreads; ++t) {
+        pool.push_back(thread(worker));
+    }
+    worker(); // the calling thread is worker number one
+    for (size_t t = 0; t < pool.size(); ++t) {
+        pool[t].join();
+    }
+    return puzzles;
+}
+
+#endif	// PUZZLE_GENERATOR
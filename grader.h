@@ -0,0 +1,117 @@
+/*
+This file contains the difficulty grader.
+A puzzle is graded by what it takes to solve: propagation runs once on the
+board with every technique on, and since it tries them cheapest first and
+goes back to singles after each one that eliminates something, the most
+expensive technique that removed a candidate is the hardest one the puzzle
+needs. The techniques are added a grade at a time, each step carrying on
+from where the last one stopped, so the many easy puzzles cost little more
+than a singles pass. If propagation alone cannot finish the board, the
+search from there measures the effort left. The grade then comes from the
+cells propagation left blank rather than from the guesses: both grow with
+the work, but the guesses depend on the cell the search happens to branch
+on, so a relabelled or mirrored copy of a puzzle could land in another
+grade, while the blanks do not change under the symmetries of transform.h.
+Uniqueness is not checked, a count costs more than the whole grade.
+*/
+
+#ifndef PUZZLE_GRADER
+#define PUZZLE_GRADER
+
+#include <cstdint>
+#include "board.h"
+
+using namespace std;
+
+// grades from cheapest to most expensive to solve
+enum Grade {
+    Easy, // naked and hidden singles alone
+    Medium, // locked candidates
+    Hard, // naked and hidden pairs and triples
+    Fiendish, // X-Wing and Swordfish
+    Diabolical, // a search from at most DiabolicalBlanks blank cells, scaled to the board
+    Extreme, // a search from more
+    Invalid, // conflicting givens or no solution
+    NumGrades
+};
+
+const int DiabolicalBlanks = 53; // most of its 81 cells a Diabolical 9x9 puzzle leaves to
+    // the search; larger boards allow the same fraction of their cells
+
+// the grade of a puzzle and what it was based on
+struct puzzleGrade {
+    Grade grade = Invalid;
+    int blanks = 0; // blank cells left once propagation was stuck
+    bool searched = false; // true if propagation alone did not solve it
+    uint64_t guesses = 0; // guesses the search made
+    uint64_t nodes = 0; // recursive calls the search made
+};
+
+// return the name of a grade
+inline const char* gradeName(Grade g) {
+    const char* const names[] = {"easy", "medium", "hard", "fiendish",
+                                 "diabolical", "extreme", "invalid"};
+    return g >= 0 && g < NumGrades ? names[g] : "unknown";
+}
+
+// the techniques each grade adds to the ones before it
+inline unsigned gradeTechniques(Grade g) {
+    switch (g) {
+    case Medium:
+        return techniqueBit(LockedCandidates);
+    case Hard:
+        return techniqueBit(NakedPairs) | techniqueBit(NakedTriples) |
+               techniqueBit(HiddenPairs) | techniqueBit(HiddenTriples);
+    case Fiendish:
+        return techniqueBit(XWing) | techniqueBit(Swordfish);
+    default:
+        return 0;
+    }
+}
+
+// grade the puzzle loaded into b. The board's options are replaced and it is
+// left solved, or as far as propagation got if it has no solution
+template <int Sq>
+puzzleGrade gradeBoard(basicBoard<Sq>& b) {
+    solveOptions opts;
+    opts.select = MinRemaining;
+    opts.propagate = true;
+    puzzleGrade g;
+
+    // climb the grades, each one propagating from where the one before
+    // stopped (reduce keeps what it places and eliminates), until the board
+    // is full; most puzzles stop after the first step or two
+    for (int level = Easy; level <= Fiendish; ++level) {
+        opts.techniques |= gradeTechniques(Grade(level));
+        b.setOptions(opts);
+        if (!b.reduce()) {
+            return g;
+        }
+        g.blanks = 0;
+        for (int i = 1; i <= basicBoard<Sq>::BoardSize; ++i) {
+            for (int j = 1; j <= basicBoard<Sq>::BoardSize; ++j) {
+                g.blanks += b.isBlank(i, j);
+            }
+        }
+        if (g.blanks == 0) {
+            g.grade = Grade(level);
+            return g;
+        }
+    }
+
+    // propagation is stuck, the eliminations it made stay for the search
+    opts.techniques = 0;
+    b.setOptions(opts);
+    g.searched = true;
+    if (!b.search()) {
+        return g;
+    }
+    // every call after the first follows a guess, with or without SUDOKU_STATS
+    g.nodes = b.getRecursiveCalls();
+    g.guesses = g.nodes - 1;
+    const int MostBlanks = DiabolicalBlanks * basicBoard<Sq>::NumCells / 81;
+    g.grade = g.blanks <= MostBlanks ? Diabolical : Extreme;
+    return g;
+}
+
+#endif	// PUZZLE_GRADER
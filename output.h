@@ -0,0 +1,331 @@
+/*
+This file contains the output formats for solved boards and the buffered
+writer they all go through. A board can be written as the ASCII grid that
+board::print draws, as one line of characters, as one JSON object per line
+with its statistics, or, for 9x9 boards, as a packed binary record or as
+a binary corpus with solutions. A board that was graded instead of solved
+is written as its grade, see grader.h. Boards of every size basicBoard supports
+can be written. The writer collects everything in one large buffer and
+only hands it to the stream when the buffer fills up or the writer is
+flushed, never once per line.
+*/
+
+#ifndef OUTPUT_WRITER
+#define OUTPUT_WRITER
+
+#include <iostream>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include "batch.h"
+#include "puzzlefile.h"
+#include "corpus.h"
+#include "grader.h"
+
+using namespace std;
+
+enum OutputFormat {
+    GridFormat, // the puzzle and the solution drawn as grids, as the menu prints them
+    LineFormat, // the solution as one line of characters
+    JsonFormat, // one JSON object per line with the puzzle, solution and statistics
+    BinaryFormat, // one packed binary record per 9x9 board, see writeBinary
+    CorpusFormat // a corpus of 9x9 boards with their solutions, see corpus.h
+};
+
+const int BinaryRecordSize = PackedCells + 1 + 4; // cells, status byte, recursive calls
+
+class outputWriter {
+public:
+    outputWriter(ostream& out, size_t capacity = 1 << 20); // constructor, buffer capacity in bytes
+    ~outputWriter(); // flush what is left
+    void write(const char* s, size_t n); // add n bytes
+    void put(char ch); // add one byte
+    void putNumber(long long n); // add a number in decimal
+    void flush(); // hand the buffer to the stream
+    void writeResult(OutputFormat format, long long index, const char* puzzle,
+                     const batchResult& result); // add one board in a format
+    void writeGrade(OutputFormat format, long long index, const char* puzzle, size_t cells,
+                    const puzzleGrade& grade); // add the grade of one board, grid, line or json
+
+private:
+    ostream& out; // where the buffer goes when it is flushed
+    vector<char> buffer; // bytes not yet handed to out
+    size_t used; // bytes of buffer in use
+
+    void writeGrid(const char* cells, int square); // the grid board::print draws
+    void writeLine(const string& cells); // the characters and a newline
+    void writeString(const char* s, size_t n); // the characters escaped for a JSON string
+    void writeJson(long long index, const char* puzzle, const batchResult& result);
+    void writeBinary(const batchResult& result);
+
+    outputWriter(const outputWriter&); // one owner per buffer
+    outputWriter& operator=(const outputWriter&);
+};
+
+inline outputWriter::outputWriter(ostream& out, size_t capacity)
+    : out(out), buffer(capacity < 256 ? 256 : capacity), used(0) {
+}
+
+inline outputWriter::~outputWriter() {
+    flush();
+}
+
+// add n bytes, passing large writes straight through
+inline void outputWriter::write(const char* s, size_t n) {
+    if (used + n > buffer.size()) {
+        flush();
+        if (n > buffer.size()) {
+            out.write(s, n);
+            return;
+        }
+    }
+    memcpy(&buffer[used], s, n);
+    used += n;
+}
+
+// add one byte
+inline void outputWriter::put(char ch) {
+    if (used == buffer.size()) {
+        flush();
+    }
+    buffer[used++] = ch;
+}
+
+// add a number in decimal
+inline void outputWriter::putNumber(long long n) {
+    char digits[24];
+    int k = sizeof(digits);
+    unsigned long long u = n < 0 ? 0 - (unsigned long long) n : n;
+    do {
+        digits[--k] = '0' + u % 10;
+        u /= 10;
+    } while (u > 0);
+    if (n < 0) {
+        digits[--k] = '-';
+    }
+    write(digits + k, sizeof(digits) - k);
+}
+
+// hand the buffer to the stream
+inline void outputWriter::flush() {
+    if (used > 0) {
+        out.write(buffer.data(), used);
+        used = 0;
+    }
+    out.flush();
+}
+
+// add one board in a format; puzzle is the board as it was read
+inline void outputWriter::writeResult(OutputFormat format, long long index, const char* puzzle,
+                                      const batchResult& result) {
+    // the squares of a board of n * n * n * n cells are n by n
+    int square = 3;
+    while (size_t(square * square * square * square) < result.solution.size()) {
+        ++square;
+    }
+    switch (format) {
+    case GridFormat:
+        writeGrid(puzzle, square);
+        if (result.invalid) {
+            write("The board has a cell that is not '.' or a value.\n", 49);
+            break;
+        }
+        if (result.counted) {
+            write("Number of solutions: ", 21);
+            putNumber(result.solutions);
+            put('\n');
+        }
+        write("Number of recursive calls: ", 27);
+        putNumber(result.recursiveCalls);
+        put('\n');
+        if (result.aborted) {
+            write("The search gave up before it finished.\n", 39);
+        }
+        if (result.solved) {
+            write("Solved board:\n", 14);
+            writeGrid(result.solution.c_str(), square);
+        } else if (!result.aborted) {
+            write("No solution exists for this board.\n", 35);
+        }
+        break;
+    case LineFormat:
+        writeLine(result.solution);
+        break;
+    case JsonFormat:
+        writeJson(index, puzzle, result);
+        break;
+    case BinaryFormat:
+        writeBinary(result);
+        break;
+    case CorpusFormat:
+        if (index == 0) {
+            char header[CorpusHeaderSize];
+            corpusHeader(true, header);
+            write(header, CorpusHeaderSize);
+        }
+        // an invalid board is left out, the caller counts it
+        unsigned char record[2 * PackedCells];
+        write((const char*) record, corpusRecord(puzzle, true,
+                                                 result.solved ? result.solution.c_str() : nullptr,
+                                                 record));
+        break;
+    }
+}
+
+// add the grade of one board of cells characters: for grid the puzzle and a
+// line with the grade, for line the grade alone, and for json one object
+// like {"index":0,"puzzle":"...","grade":"hard","blanks":0,"guesses":0,"calls":0}
+// with the blanks propagation left and the search that finished from there
+inline void outputWriter::writeGrade(OutputFormat format, long long index, const char* puzzle,
+                                     size_t cells, const puzzleGrade& grade) {
+    const char* name = gradeName(grade.grade);
+    if (format == GridFormat) {
+        int square = 3;
+        while (size_t(square * square * square * square) < cells) {
+            ++square;
+        }
+        writeGrid(puzzle, square);
+        write("Grade: ", 7);
+        write(name, strlen(name));
+        put('\n');
+    } else if (format == JsonFormat) {
+        write("{\"index\":", 9);
+        putNumber(index);
+        write(",\"puzzle\":\"", 11);
+        writeString(puzzle, cells);
+        write("\",\"grade\":\"", 11);
+        write(name, strlen(name));
+        write("\",\"blanks\":", 11);
+        putNumber(grade.blanks);
+        write(",\"guesses\":", 11);
+        putNumber(grade.guesses);
+        write(",\"calls\":", 9);
+        putNumber(grade.nodes);
+        write("}\n", 2);
+    } else {
+        write(name, strlen(name));
+        put('\n');
+    }
+}
+
+// add the grid board::print draws for a board with squares of square by square cells
+inline void outputWriter::writeGrid(const char* cells, int square) {
+    const int MaxSide = 25;
+    int side = square * square;
+    char border[3 * MaxSide + 4];
+    int n = 0;
+    border[n++] = ' ';
+    border[n++] = '-';
+    for (int j = 0; j < side; ++j) {
+        border[n++] = '-';
+        border[n++] = '-';
+        border[n++] = '-';
+    }
+    border[n++] = '-';
+    border[n++] = '\n';
+
+    for (int i = 0; i < side; ++i) {
+        if (i % square == 0) {
+            write(border, n);
+        }
+        char line[4 * MaxSide + 2];
+        int k = 0;
+        for (int j = 0; j < side; ++j) {
+            if (j % square == 0) {
+                line[k++] = '|';
+            }
+            char ch = cells[i * side + j];
+            line[k++] = ' ';
+            line[k++] = ch == '.' ? ' ' : ch;
+            line[k++] = ' ';
+        }
+        line[k++] = '|';
+        line[k++] = '\n';
+        write(line, k);
+    }
+    write(border, n);
+}
+
+// add the characters of a board and a newline
+inline void outputWriter::writeLine(const string& cells) {
+    write(cells.data(), cells.size());
+    put('\n');
+}
+
+// add the characters of s for the inside of a JSON string: quotes and
+// backslashes get a backslash, and control and non-ASCII bytes become \u00XX
+inline void outputWriter::writeString(const char* s, size_t n) {
+    static const char Hex[] = "0123456789abcdef";
+    for (size_t k = 0; k < n; ++k) {
+        unsigned char ch = s[k];
+        if (ch == '"' || ch == '\\') {
+            put('\\');
+            put(ch);
+        } else if (ch < 0x20 || ch >= 0x7F) {
+            write("\\u00", 4);
+            put(Hex[ch >> 4]);
+            put(Hex[ch & 15]);
+        } else {
+            put(ch);
+        }
+    }
+}
+
+// add one JSON object on its own line, e.g.
+// {"index":0,"puzzle":"...","solution":"...","solved":true,"solutions":1,"calls":44,
+//  "guesses":12,"backtracks":11,"depth":3}
+// where the last three are left out when SUDOKU_STATS is off, and
+// "aborted":true is added before the end when the search gave up. A board
+// that is not valid input gets {"index":0,"puzzle":"...","error":"..."} instead
+inline void outputWriter::writeJson(long long index, const char* puzzle, const batchResult& result) {
+    write("{\"index\":", 9);
+    putNumber(index);
+    write(",\"puzzle\":\"", 11);
+    writeString(puzzle, result.solution.size());
+    if (result.invalid) {
+        write("\",\"error\":\"a cell is not '.' or a value\"}\n", 42);
+        return;
+    }
+    write("\",\"solution\":\"", 14);
+    write(result.solution.data(), result.solution.size());
+    write("\",\"solved\":", 11);
+    if (result.solved) {
+        write("true", 4);
+    } else {
+        write("false", 5);
+    }
+    write(",\"solutions\":", 13);
+    putNumber(result.solutions);
+    write(",\"calls\":", 9);
+    putNumber(result.recursiveCalls);
+    if (CollectStats) {
+        write(",\"guesses\":", 11);
+        putNumber(result.guesses);
+        write(",\"backtracks\":", 14);
+        putNumber(result.backtracks);
+        write(",\"depth\":", 9);
+        putNumber(result.maxDepth);
+    }
+    if (result.aborted) {
+        write(",\"aborted\":true", 15);
+    }
+    write("}\n", 2);
+}
+
+// add a packed record of BinaryRecordSize bytes: the cells two to a byte,
+// first cell in the high half and 0 for a blank, then 1 if the board was
+// solved, 2 if the search gave up, 3 if the board is not valid input or 0 if
+// it has no solution, then the recursive calls as 4 bytes, low byte first
+// (0xFFFFFFFF if there were more)
+inline void outputWriter::writeBinary(const batchResult& result) {
+    unsigned char record[BinaryRecordSize];
+    packCells(result.solution.c_str(), record);
+    record[PackedCells] = result.solved ? 1 : result.aborted ? 2 : result.invalid ? 3 : 0;
+    uint32_t calls = result.recursiveCalls > 0xFFFFFFFFLL ? 0xFFFFFFFF : result.recursiveCalls;
+    for (int b = 0; b < 4; ++b) {
+        record[PackedCells + 1 + b] = calls >> (8 * b);
+    }
+    write((const char*) record, BinaryRecordSize);
+}
+
+#endif	// OUTPUT_WRITER
@@ -0,0 +1,253 @@
+/*
+This file contains the parallel search for a single hard board.
+The top few levels of the search tree are split into tasks, one per value
+tried in the branching cell, and every task carries its own copy of the board.
+Each thread keeps a deque of tasks: it works on its newest task from the back
+and, when it runs dry, steals the oldest (largest) task from another thread's
+front. Below the split depth a task is solved by the normal sequential search.
+The first thread to find a solution raises a flag that every other search
+checks at every node it visits, so the rest give up straight away. The same
+flag stops them when the caller's stop flag goes up or the node and time
+budgets, which the tasks share, run out.
+*/
+
+#ifndef PARALLEL_SEARCH
+#define PARALLEL_SEARCH
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include "board.h"
+
+using namespace std;
+
+// a subtree of the search: the board with the values placed on the way to it
+struct searchTask {
+    board b; // board state at the root of the subtree
+    int depth; // number of values placed above the root of the subtree
+};
+
+// tasks of one worker, the owner uses the back and thieves take from the front
+class taskDeque {
+public:
+    void push(const searchTask& t); // add a task at the owner's end
+    bool pop(searchTask& t); // take the newest task, false if there is none
+    bool steal(searchTask& t); // take the oldest task, false if there is none
+
+private:
+    mutex lock; // guards tasks, held only while a task is moved in or out
+    deque<searchTask> tasks;
+};
+
+inline void taskDeque::push(const searchTask& t) {
+    lock_guard<mutex> guard(lock);
+    tasks.push_back(t);
+}
+
+inline bool taskDeque::pop(searchTask& t) {
+    lock_guard<mutex> guard(lock);
+    if (tasks.empty()) {
+        return false;
+    }
+    t = tasks.back();
+    tasks.pop_back();
+    return true;
+}
+
+inline bool taskDeque::steal(searchTask& t) {
+    lock_guard<mutex> guard(lock);
+    if (tasks.empty()) {
+        return false;
+    }
+    t = tasks.front();
+    tasks.pop_front();
+    return true;
+}
+
+// solve one board with numThreads threads, splitting the search into tasks
+// down to splitDepth placements; on success b holds the solution,
+// recursiveCalls gets the calls made by all threads together and aborted
+// tells if the search gave up. The stop flag and the budgets of opts hold
+// for the whole search, not for each task
+inline bool solveParallel(board& b, const solveOptions& opts, int numThreads,
+                          int splitDepth, long long& recursiveCalls, bool& aborted) {
+    if (numThreads < 1) {
+        numThreads = 1;
+    }
+    atomic<bool> found(false);
+    atomic<bool> gaveUp(false);
+    atomic<bool> halt(false); // every search stops: a win, the caller's stop or no budget left
+    atomic<int> pending(1); // tasks queued or running, the search is over at 0
+    atomic<long long> calls(0);
+    vector<taskDeque> queues(numThreads);
+    board winner;
+
+    // the tasks stop at halt and share one deadline and one pool of nodes;
+    // a search takes a small share of the nodes left at a time, takes more
+    // when it runs through it and hands back what it did not use, so the
+    // tasks together make at most maxNodes calls and only give the whole
+    // search up once the pool is empty
+    solveOptions taskOpts = opts;
+    taskOpts.stop = &halt;
+    atomic<long long> nodesLeft(opts.maxNodes);
+    if (opts.maxNodes > 0) {
+        taskOpts.maxNodes = max(1LL, opts.maxNodes / numThreads);
+        if (taskOpts.maxNodes > searchBudget::ClockInterval) {
+            taskOpts.maxNodes = searchBudget::ClockInterval;
+        }
+        taskOpts.nodePool = &nodesLeft;
+    }
+    chrono::steady_clock::time_point deadline =
+        chrono::steady_clock::now() + chrono::milliseconds(opts.maxMillis);
+
+    searchTask root;
+    root.b = b;
+    root.depth = 0;
+    queues[0].push(root);
+
+    // claim the win for a solved board, only the first claim counts
+    auto finish = [&](board& solved) {
+        bool expected = false;
+        if (found.compare_exchange_strong(expected, true)) {
+            winner = solved;
+            halt = true;
+        }
+    };
+
+    auto giveUp = [&]() {
+        if (!found) {
+            gaveUp = true;
+        }
+        halt = true;
+    };
+
+    // split a shallow task into one child per value of its most constrained
+    // cell, or search a deep one to the end
+    auto runTask = [&](int id, searchTask& t) {
+        solveOptions o = taskOpts;
+        if (opts.maxMillis > 0) {
+            // round up, a task started with part of a millisecond left still gets it
+            o.maxMillis = chrono::ceil<chrono::milliseconds>(
+                deadline - chrono::steady_clock::now()).count();
+            if (o.maxMillis <= 0) {
+                giveUp();
+                return;
+            }
+        }
+        if (t.depth >= splitDepth) {
+            t.b.setOptions(o);
+            bool solved = t.b.search();
+            calls += t.b.getRecursiveCalls();
+            if (solved) {
+                finish(t.b);
+            } else if (t.b.getStats().aborted) {
+                giveUp();
+            }
+            return;
+        }
+
+        if (opts.maxNodes > 0 && takeNodes(nodesLeft, 1) == 0) {
+            giveUp();
+            return;
+        }
+        ++calls;
+        t.b.setOptions(o);
+        if (!t.b.reduce()) {
+            return;
+        }
+        int bestI = 0;
+        int bestJ = 0;
+        int bestCount = MaxValue + 1;
+        for (int i = 1; i <= BoardSize; ++i) {
+            for (int j = 1; j <= BoardSize; ++j) {
+                if (t.b.isBlank(i, j)) {
+                    int count = __builtin_popcount(t.b.candidates(i, j));
+                    if (count < bestCount) {
+                        bestI = i;
+                        bestJ = j;
+                        bestCount = count;
+                    }
+                }
+            }
+        }
+        if (bestCount > MaxValue) {
+            finish(t.b);
+            return;
+        }
+
+        // push the largest value first so the owner pops the smallest first,
+        // the same order the sequential search tries them in
+        ValueMask cand = t.b.candidates(bestI, bestJ);
+        for (ValueType val = MaxValue; val >= MinValue; --val) {
+            if (cand & valueBit(val)) {
+                searchTask child;
+                child.b = t.b;
+                child.b.setCell(bestI, bestJ, val);
+                child.depth = t.depth + 1;
+                ++pending;
+                queues[id].push(child);
+            }
+        }
+    };
+
+    atomic<int> running(numThreads); // workers not done yet
+    auto worker = [&](int id) {
+        searchTask t;
+        while (!halt.load()) {
+            if (opts.stop && opts.stop->load()) {
+                giveUp();
+                break;
+            }
+            bool got = queues[id].pop(t);
+            for (int k = 1; !got && k < numThreads; ++k) {
+                got = queues[(id + k) % numThreads].steal(t);
+            }
+            if (!got) {
+                if (pending.load() == 0) {
+                    break;
+                }
+                this_thread::yield();
+                continue;
+            }
+            runTask(id, t);
+            --pending;
+        }
+        --running;
+    };
+
+    vector<thread> pool;
+    if (opts.stop) {
+        // the calling thread watches the caller's stop flag and passes it on
+        // to the searches in progress, which only see halt
+        for (int t = 0; t < numThreads; ++t) {
+            pool.push_back(thread(worker, t));
+        }
+        while (running.load() > 0) {
+            if (opts.stop->load()) {
+                giveUp();
+            }
+            this_thread::sleep_for(chrono::milliseconds(1));
+        }
+    } else {
+        for (int t = 1; t < numThreads; ++t) {
+            pool.push_back(thread(worker, t));
+        }
+        worker(0);
+    }
+    for (size_t t = 0; t < pool.size(); ++t) {
+        pool[t].join();
+    }
+
+    recursiveCalls = calls;
+    aborted = gaveUp && !found;
+    if (found) {
+        b = winner;
+        b.setOptions(opts); // the copy still points at this call's stop flag
+    }
+    return found;
+}
+
+#endif	// PARALLEL_SEARCH
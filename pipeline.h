@@ -0,0 +1,183 @@
+/*
+This file contains the pipeline the command line runs large jobs through.
+Reading, solving and writing are separate stages on separate threads, so
+the input is parsed and the output written while the boards are solved:
+a reader thread cuts the input into chunks of boards, a pool of worker
+threads solves one chunk at a time each, and the writer, on the calling
+thread, writes the chunks out. The stages hand chunks along through
+bounded queues.
+
+A fixed number of chunks is made at the start and they go round and round:
+the reader takes an empty chunk from the spare queue, fills it and passes it
+on to the workers, and the writer puts it back on the spare queue once it is
+written. So the reader waits whenever it is that many chunks ahead of the
+writer, however big the input, and the memory of the whole job is the
+memory of those chunks. In order, the writer holds back a chunk that
+finished early until every chunk before it is written; out of order it
+writes each chunk as soon as it is solved.
+*/
+
+#ifndef SOLVE_PIPELINE
+#define SOLVE_PIPELINE
+
+#include <vector>
+#include <deque>
+#include <map>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include "batch.h"
+
+using namespace std;
+
+// a queue that holds at most capacity items: push waits while it is full and
+// pop while it is empty, until the queue is closed
+template <typename T>
+class boundedQueue {
+public:
+    boundedQueue(size_t capacity);
+    bool push(const T& item); // add an item, false if the queue is closed
+    bool pop(T& item); // take the oldest item, false once closed and empty
+    void close(); // wake everyone waiting, no more pushes
+
+private:
+    mutex lock; // guards everything below
+    condition_variable notEmpty;
+    condition_variable notFull;
+    deque<T> items;
+    size_t capacity;
+    bool closed;
+};
+
+template <typename T>
+inline boundedQueue<T>::boundedQueue(size_t capacity) :
+    capacity(capacity < 1 ? 1 : capacity), closed(false) {
+}
+
+template <typename T>
+inline bool boundedQueue<T>::push(const T& item) {
+    unique_lock<mutex> guard(lock);
+    notFull.wait(guard, [&]() { return closed || items.size() < capacity; });
+    if (closed) {
+        return false;
+    }
+    items.push_back(item);
+    notEmpty.notify_one();
+    return true;
+}
+
+template <typename T>
+inline bool boundedQueue<T>::pop(T& item) {
+    unique_lock<mutex> guard(lock);
+    notEmpty.wait(guard, [&]() { return closed || !items.empty(); });
+    if (items.empty()) {
+        return false;
+    }
+    item = items.front();
+    items.pop_front();
+    notFull.notify_one();
+    return true;
+}
+
+template <typename T>
+inline void boundedQueue<T>::close() {
+    lock_guard<mutex> guard(lock);
+    closed = true;
+    notEmpty.notify_all();
+    notFull.notify_all();
+}
+
+// boards on their way through the pipeline
+struct pipelineChunk {
+    long long sequence; // number of the chunk in input order, from 0
+    long long first; // index of its first board in the whole input
+    vector<string> boards; // the boards as read
+    vector<batchResult> results; // one per board once a worker has solved it
+    vector<puzzleGrade> grades; // one per board instead when the boards are graded
+};
+
+// run read, work and write as a pipeline with numThreads workers and
+// numChunks chunks going round (0 for enough to keep every stage busy).
+// read(chunk) fills chunk.boards and returns false at the end of the input,
+// work(chunk, worker) solves them on worker thread number worker, from 0 to
+// numThreads - 1, and write(chunk) writes them on the calling thread, in
+// input order if ordered is set
+template <typename Reader, typename Worker, typename Writer>
+void runPipeline(Reader read, Worker work, Writer write, int numThreads,
+                 bool ordered = true, size_t numChunks = 0) {
+    if (numThreads < 1) {
+        numThreads = 1;
+    }
+    if (numChunks == 0) {
+        numChunks = 2 * numThreads + 2; // one being read, one being written, two per worker
+    }
+    vector<pipelineChunk> chunks(numChunks);
+    boundedQueue<pipelineChunk*> spare(numChunks), toWork(numChunks), toWrite(numChunks);
+    for (size_t c = 0; c < chunks.size(); ++c) {
+        spare.push(&chunks[c]);
+    }
+
+    thread reader([&]() {
+        long long sequence = 0;
+        long long first = 0;
+        pipelineChunk* c;
+        while (spare.pop(c)) {
+            c->boards.clear();
+            if (!read(*c) || c->boards.empty()) {
+                break;
+            }
+            c->sequence = sequence++;
+            c->first = first;
+            first += c->boards.size();
+            toWork.push(c);
+        }
+        toWork.close();
+    });
+
+    vector<thread> workers;
+    size_t running = numThreads; // workers not done yet, guarded by doneLock
+    mutex doneLock;
+    for (int t = 0; t < numThreads; ++t) {
+        workers.push_back(thread([&, t]() {
+            pipelineChunk* c;
+            while (toWork.pop(c)) {
+                work(*c, t);
+                toWrite.push(c);
+            }
+            // the last worker out tells the writer there is nothing more
+            lock_guard<mutex> guard(doneLock);
+            if (--running == 0) {
+                toWrite.close();
+            }
+        }));
+    }
+
+    // chunks that finished before one ahead of them, by sequence
+    map<long long, pipelineChunk*> waiting;
+    long long next = 0;
+    pipelineChunk* c;
+    while (toWrite.pop(c)) {
+        if (!ordered) {
+            write(*c);
+            spare.push(c);
+            continue;
+        }
+        waiting[c->sequence] = c;
+        while (!waiting.empty() && waiting.begin()->first == next) {
+            c = waiting.begin()->second;
+            waiting.erase(waiting.begin());
+            write(*c);
+            spare.push(c);
+            ++next;
+        }
+    }
+
+    spare.close();
+    reader.join();
+    for (size_t t = 0; t < workers.size(); ++t) {
+        workers[t].join();
+    }
+}
+
+#endif	// SOLVE_PIPELINE
@@ -0,0 +1,216 @@
+/*
+This file contains the memory-mapped reader for puzzle files.
+The whole file is mapped read-only and indexed once: every board is 81
+non-blank characters in the format board::initialize reads (256 or 625 for
+the larger boards), and the index
+keeps a pointer to where each board starts. A board is handed out as a
+pointer into the mapping, so nothing is copied or read through a stream.
+Boards whose characters are broken up by whitespace are the one exception;
+they are packed into a side buffer when the file is indexed.
+Byte offsets map back to board numbers, so workers can split a file by
+byte range.
+*/
+
+#ifndef PUZZLE_FILE
+#define PUZZLE_FILE
+
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cstddef>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "d_except.h"
+
+using namespace std;
+
+const int RecordSize = 81; // characters in one 9x9 board
+const int PackedCells = (RecordSize + 1) / 2; // bytes of a 9x9 board at two cells per byte
+
+class puzzleFile {
+public:
+    puzzleFile(); // constructor, no file open
+    ~puzzleFile(); // unmap the file
+    void open(const string& fileName, int cells = RecordSize); // map and index a file, throws fileOpenError
+    void close(); // unmap the file and forget its index
+    int size() const; // number of boards in the file
+    const char* record(int n) const; // the characters of board n
+    size_t offset(int n) const; // byte offset in the file where board n starts
+    int boardAt(size_t byteOffset) const; // first board starting at or after a byte offset
+    size_t bytes() const; // size of the file in bytes
+
+private:
+    const char* data; // the mapping, nullptr when no file is open
+    size_t length; // bytes mapped
+    int recordSize; // characters in one board
+    vector<const char*> records; // start of every board, in the mapping or in packed
+    vector<size_t> starts; // byte offset in the file where every board starts
+    string packed; // boards that had whitespace inside them, packed together
+
+    puzzleFile(const puzzleFile&); // a mapping has one owner
+    puzzleFile& operator=(const puzzleFile&);
+};
+
+// return true for the characters the stream reader would skip
+inline bool isSpace(char ch) {
+    return ch == ' ' || ch == '\n' || ch == '\r' || ch == '\t' || ch == '\v' || ch == '\f';
+}
+
+// return true if packCells keeps all 81 characters of a 9x9 board, that is
+// every one is '.' or 1 to 9; anything else would come back as a blank
+inline bool packable(const char* cells) {
+    for (int k = 0; k < RecordSize; ++k) {
+        if (cells[k] != '.' && (cells[k] < '1' || cells[k] > '9')) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// pack the 81 characters of a 9x9 board into PackedCells bytes, four bits a
+// cell with the first cell in the high half and 0 for a blank
+inline void packCells(const char* cells, unsigned char* packed) {
+    for (int k = 0; k < PackedCells; ++k) {
+        packed[k] = 0;
+    }
+    for (int k = 0; k < RecordSize; ++k) {
+        unsigned char val = cells[k] >= '1' && cells[k] <= '9' ? cells[k] - '0' : 0;
+        packed[k / 2] |= k % 2 == 0 ? val << 4 : val;
+    }
+}
+
+// unpack a board packed by packCells back into 81 characters
+inline void unpackCells(const unsigned char* packed, char* cells) {
+    for (int k = 0; k < RecordSize; ++k) {
+        unsigned char val = k % 2 == 0 ? packed[k / 2] >> 4 : packed[k / 2] & 0xF;
+        cells[k] = val == 0 ? '.' : '0' + val;
+    }
+}
+
+inline puzzleFile::puzzleFile() : data(nullptr), length(0), recordSize(RecordSize) {
+}
+
+inline puzzleFile::~puzzleFile() {
+    close();
+}
+
+// map a file and index its boards of cells characters each, up to the 'Z'
+// marker or the end of the file
+inline void puzzleFile::open(const string& fileName, int cells) {
+    close();
+    recordSize = cells;
+
+    int fd = ::open(fileName.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw fileOpenError(fileName);
+    }
+    struct stat info;
+    if (fstat(fd, &info) < 0) {
+        ::close(fd);
+        throw fileOpenError(fileName);
+    }
+    length = info.st_size;
+    if (length > 0) {
+        void* map = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (map == MAP_FAILED) {
+            ::close(fd);
+            length = 0;
+            throw fileOpenError(fileName);
+        }
+        data = (const char*) map;
+        madvise(map, length, MADV_WILLNEED);
+    }
+    ::close(fd); // the mapping stays valid without the descriptor
+
+    // the usual layout is one board and a newline per line, so the common
+    // case is one check that the next recordSize bytes hold no whitespace
+    vector<size_t> split; // boards that have to be packed, by index
+    size_t p = 0;
+    while (true) {
+        while (p < length && isSpace(data[p])) {
+            ++p;
+        }
+        if (p >= length || data[p] == 'Z') {
+            break;
+        }
+        size_t start = p;
+        size_t end = min(length, p + recordSize);
+        while (p < end && !isSpace(data[p])) {
+            ++p;
+        }
+        if (p == start + recordSize) {
+            records.push_back(data + start);
+            starts.push_back(start);
+            continue;
+        }
+
+        // whitespace inside the board, gather its characters one by one
+        string board(data + start, p - start);
+        while (p < length && board.size() < size_t(recordSize)) {
+            if (!isSpace(data[p])) {
+                board += data[p];
+            }
+            ++p;
+        }
+        if (board.size() < size_t(recordSize)) {
+            break; // a partial board at the end of the file is ignored
+        }
+        split.push_back(records.size());
+        records.push_back(nullptr);
+        starts.push_back(start);
+        packed += board;
+    }
+
+    // packed only stops growing here, so point into it now
+    for (size_t k = 0; k < split.size(); ++k) {
+        records[split[k]] = packed.data() + k * recordSize;
+    }
+}
+
+// unmap the file and forget its index
+inline void puzzleFile::close() {
+    if (data) {
+        munmap((void*) data, length);
+    }
+    data = nullptr;
+    length = 0;
+    records.clear();
+    starts.clear();
+    packed.clear();
+}
+
+// get the number of boards in the file
+inline int puzzleFile::size() const {
+    return records.size();
+}
+
+// get the characters of board n, ready for board::initialize
+inline const char* puzzleFile::record(int n) const {
+    if (n < 0 || n >= size()) {
+        throw indexRangeError("puzzleFile: invalid board number", n, size());
+    }
+    return records[n];
+}
+
+// get the byte offset in the file where board n starts
+inline size_t puzzleFile::offset(int n) const {
+    if (n < 0 || n >= size()) {
+        throw indexRangeError("puzzleFile: invalid board number", n, size());
+    }
+    return starts[n];
+}
+
+// get the first board that starts at or after a byte offset, size() if none;
+// the boards of the byte range [a, b) are boardAt(a) up to boardAt(b)
+inline int puzzleFile::boardAt(size_t byteOffset) const {
+    return lower_bound(starts.begin(), starts.end(), byteOffset) - starts.begin();
+}
+
+// get the size of the file in bytes
+inline size_t puzzleFile::bytes() const {
+    return length;
+}
+
+#endif	// PUZZLE_FILE
@@ -0,0 +1,299 @@
+/*
+This file contains the solver daemon. It listens on a Unix domain socket and
+stays up, so a service that wants one board solved pays for a round trip and
+the search, not for starting a process and opening files.
+The protocol is lines of text. A client sends boards one per line, in the
+same characters as a file ('.' for a blank, whitespace ignored), and gets
+back one JSON line per board, in order, in the format of -f json with the
+index counting the boards sent on the connection. A line that is not a board,
+because of its length or a character that is not '.' or a value of the
+board's size, gets {"index":n,"error":"..."} instead and is not echoed, a blank line is skipped, and a line
+holding just 'Z' closes the connection, as it ends a file.
+
+Requests are pipelined: a client may send any number of boards without
+waiting, and every board that has fully arrived is solved and answered with
+one write. Each connection has a thread of its own with a boardSolver built
+once when it connects, so the boards of a connection are solved one after
+another and several connections are solved at the same time. The cache and
+the store, if the command line gave them, are shared by every connection.
+SIGINT or SIGTERM stops the server: it stops the searches still running
+through their stop flag, closes the connections, joins their threads and
+removes the socket. --max-nodes and --time-limit hold every board to a
+budget, so one bad board cannot tie up its connection; it is answered
+with "aborted":true.
+*/
+
+#ifndef SOLVER_SERVER
+#define SOLVER_SERVER
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <list>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <cerrno>
+#include <csignal>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "d_except.h"
+#include "batch.h"
+#include "output.h"
+#include "store.h"
+
+using namespace std;
+
+const size_t MaxRequestLine = 1 << 16; // longest line a client may send before it is cut off
+
+// what every connection of a server shares
+struct serverOptions {
+    solveOptions opts; // options of every board's search
+    SolveEngine engine = Backtracking;
+    long long limit = 2; // solutions CountSolutions stops at
+    solutionCache* cache = nullptr; // canonical-form cache, nullptr for none
+    puzzleStore* store = nullptr; // solution store to answer from and add to, nullptr for none
+};
+
+// a stream buffer that sends straight to a socket; the outputWriter in front
+// of it does the buffering, so every flush is one send
+class socketBuf : public streambuf {
+public:
+    socketBuf(int fd) : fd(fd), failed(false) {}
+    bool bad() const { return failed; } // true once the peer has gone
+
+protected:
+    streamsize xsputn(const char* s, streamsize n) override;
+    int overflow(int ch) override;
+
+private:
+    int fd;
+    bool failed;
+};
+
+// send all n bytes, false once the peer has gone; MSG_NOSIGNAL keeps a
+// closed connection from raising SIGPIPE
+inline streamsize socketBuf::xsputn(const char* s, streamsize n) {
+    streamsize sent = 0;
+    while (!failed && sent < n) {
+        ssize_t k = send(fd, s + sent, n - sent, MSG_NOSIGNAL);
+        if (k < 0 && errno == EINTR) {
+            continue;
+        }
+        if (k <= 0) {
+            failed = true;
+            break;
+        }
+        sent += k;
+    }
+    return sent;
+}
+
+inline int socketBuf::overflow(int ch) {
+    if (ch == EOF) {
+        return 0;
+    }
+    char c = ch;
+    return xsputn(&c, 1) == 1 ? ch : EOF;
+}
+
+// set by SIGINT and SIGTERM to stop the accept loop
+inline volatile sig_atomic_t& serverStopping() {
+    static volatile sig_atomic_t stopping = 0;
+    return stopping;
+}
+
+inline void stopServer(int) {
+    serverStopping() = 1;
+}
+
+// bind and listen on a Unix domain socket at path; a socket file left behind
+// by a server that did not shut down is replaced. throws fileOpenError
+inline int listenSocket(const string& path) {
+    sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (path.empty() || path.size() >= sizeof(addr.sun_path)) {
+        throw fileOpenError(path);
+    }
+    memcpy(addr.sun_path, path.c_str(), path.size());
+
+    struct stat info;
+    if (stat(path.c_str(), &info) == 0 && S_ISSOCK(info.st_mode)) {
+        unlink(path.c_str());
+    }
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        throw fileOpenError(path);
+    }
+    if (bind(fd, (sockaddr*) &addr, sizeof(addr)) < 0 || listen(fd, SOMAXCONN) < 0) {
+        ::close(fd);
+        throw fileOpenError(path);
+    }
+    return fd;
+}
+
+// answer the boards of one connection until the client closes it, sends 'Z'
+// or the server stops
+template <int Sq>
+void serveConnection(int fd, const serverOptions& server) {
+    const size_t NumCells = basicBoard<Sq>::NumCells;
+    boardSolver<Sq> solver(server.opts, server.engine, server.limit, server.cache);
+    bool stored = Sq == 3 && server.store && server.engine != CountSolutions;
+    socketBuf buf(fd);
+    ostream stream(&buf);
+    outputWriter out(stream, 1 << 16);
+    batchResult result;
+    long long index = 0;
+    string pending; // bytes of a line that has not fully arrived
+    string cells;
+    char data[1 << 16];
+    bool open = true;
+
+    while (open && !buf.bad()) {
+        ssize_t n = recv(fd, data, sizeof(data), 0);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            break;
+        }
+        // answer every line that is complete, then send them all at once
+        pending.append(data, n);
+        size_t start = 0;
+        for (size_t end; open && (end = pending.find('\n', start)) != string::npos; start = end + 1) {
+            cells.clear();
+            for (size_t k = start; k < end; ++k) {
+                if (!isSpace(pending[k])) {
+                    cells += pending[k];
+                }
+            }
+            if (cells.empty()) {
+                continue;
+            }
+            if (cells == "Z") {
+                open = false;
+                break;
+            }
+            if (cells.size() != NumCells) {
+                out.write("{\"index\":", 9);
+                out.putNumber(index++);
+                out.write(",\"error\":\"a board needs ", 24);
+                out.putNumber(NumCells);
+                out.write(" cells\"}\n", 9);
+                continue;
+            }
+            if (!isBoardText(cells.c_str(), NumCells, basicBoard<Sq>::MaxValue)) {
+                out.write("{\"index\":", 9);
+                out.putNumber(index++);
+                out.write(",\"error\":\"a cell is not '.' or a value\"}\n", 41);
+                continue;
+            }
+            if (!stored || !server.store->find(cells.c_str(), result)) {
+                solver.solve(cells.c_str(), result);
+                if (stored) {
+                    server.store->insert(cells.c_str(), result);
+                }
+            }
+            out.writeResult(JsonFormat, index++, cells.c_str(), result);
+        }
+        pending.erase(0, start);
+        if (pending.size() > MaxRequestLine) {
+            out.write("{\"index\":", 9);
+            out.putNumber(index);
+            out.write(",\"error\":\"line too long\"}\n", 26);
+            open = false;
+        }
+        out.flush();
+    }
+    shutdown(fd, SHUT_RDWR);
+}
+
+// accept connections on a Unix domain socket at path and answer each on a
+// thread of its own until SIGINT or SIGTERM. throws fileOpenError if the
+// socket cannot be made
+template <int Sq>
+void runServer(const string& path, const serverOptions& server) {
+    // a connection: its thread, its socket, and whether the thread is done
+    struct connection {
+        thread worker;
+        int fd;
+        atomic<bool> done;
+    };
+
+    int listener = listenSocket(path);
+    struct sigaction stop, oldInt, oldTerm;
+    memset(&stop, 0, sizeof(stop));
+    stop.sa_handler = stopServer; // no SA_RESTART, so accept returns on a signal
+    sigaction(SIGINT, &stop, &oldInt);
+    sigaction(SIGTERM, &stop, &oldTerm);
+    serverStopping() = 0;
+
+    // connection threads block the signals so they always reach accept
+    sigset_t signals, oldMask;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+
+    // the connections search with a stop flag of the server's own, raised
+    // at shutdown so a long search does not hold it up
+    atomic<bool> cancel(false);
+    serverOptions shared = server;
+    if (!shared.opts.stop) {
+        shared.opts.stop = &cancel;
+    }
+
+    list<connection> connections;
+    // join the threads that are done and close their sockets; with all set,
+    // cut off the rest first and wait for them too
+    auto reap = [&](bool all) {
+        for (auto it = connections.begin(); it != connections.end(); ) {
+            if (all && !it->done) {
+                shutdown(it->fd, SHUT_RDWR);
+            }
+            if (all || it->done) {
+                it->worker.join();
+                ::close(it->fd);
+                it = connections.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    };
+
+    while (!serverStopping()) {
+        int fd = accept(listener, nullptr, nullptr);
+        if (fd < 0) {
+            if (errno == EMFILE || errno == ENFILE || errno == ENOBUFS || errno == ENOMEM) {
+                // out of descriptors or memory: close the connections that are
+                // done and wait a little instead of spinning until one frees up
+                reap(false);
+                this_thread::sleep_for(chrono::milliseconds(10));
+            }
+            continue; // EINTR from a signal, or a client that gave up before it was accepted
+        }
+        reap(false);
+        connections.emplace_back();
+        connection& c = connections.back();
+        c.fd = fd;
+        c.done = false;
+        pthread_sigmask(SIG_BLOCK, &signals, &oldMask);
+        c.worker = thread([&c, &shared]() {
+            serveConnection<Sq>(c.fd, shared);
+            c.done = true;
+        });
+        pthread_sigmask(SIG_SETMASK, &oldMask, nullptr);
+    }
+
+    cancel = true;
+    reap(true);
+    ::close(listener);
+    unlink(path.c_str());
+    sigaction(SIGINT, &oldInt, nullptr);
+    sigaction(SIGTERM, &oldTerm, nullptr);
+}
+
+#endif	// SOLVER_SERVER
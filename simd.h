@@ -0,0 +1,249 @@
+/*
+This file contains the vector kernel that computes candidates for the whole 9x9 grid.
+One pass ANDs the row, column, square and per-cell masks of every cell, counts
+the candidates of each cell, finds the blank cell with the fewest candidates and
+marks every blank cell that has exactly one. Each grid row is one vector of
+sixteen 16-bit lanes (nine used). The AVX2 version handles a row in one
+register, the SSE4.1 version in two, and a plain loop covers other machines.
+The best version the processor supports is picked once, at run time.
+*/
+
+#ifndef SIMD_KERNEL
+#define SIMD_KERNEL
+
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define SIMD_X86 1
+#endif
+
+using namespace std;
+
+const int ScanSide = 9; // the kernel is written for the 9x9 board
+const int ScanCells = ScanSide * ScanSide;
+const int ScanPadded = ScanCells + 7; // room for the last row's 16-lane store
+
+// the board state the kernel reads; unit masks are indexed 0 to 8 and cell
+// masks row by row, with cell arrays padded to ScanPadded entries
+struct scanInput {
+    const uint16_t* rowFree; // values still legal in each row
+    const uint16_t* colFree; // values still legal in each column
+    const uint16_t* squareFree; // values still legal in each square
+    const uint16_t* blankCols; // blank columns of each row, bit j for column j
+    const uint16_t* allowed; // values not ruled out in each cell, ScanPadded entries
+};
+
+// what one pass over the grid produces
+struct scanResult {
+    uint16_t cand[ScanPadded]; // candidates of each cell, 0 for a filled cell
+    uint16_t count[ScanPadded]; // number of candidates of each cell
+    int best; // blank cell with the fewest candidates (lowest index on ties), -1 if none
+    int bestCount; // its number of candidates, 0 means the board is stuck
+    uint64_t singles[2]; // bit k of the pair set for each blank cell k with one candidate
+};
+
+// the key min-reduction orders cells by: candidate count, then cell index
+inline uint16_t scanKey(int count, int cell) {
+    return uint16_t(count << 8 | cell);
+}
+
+// turn the smallest key into best and bestCount
+inline void scanFinish(uint16_t key, scanResult& out) {
+    if (key == 0xFFFF) {
+        out.best = -1;
+        out.bestCount = 0;
+    } else {
+        out.best = key & 0xFF;
+        out.bestCount = key >> 8;
+    }
+}
+
+// plain version for processors without SSE4.1 or AVX2
+inline void scanScalar(const scanInput& in, scanResult& out) {
+    uint16_t best = 0xFFFF;
+    out.singles[0] = out.singles[1] = 0;
+    for (int r = 0; r < ScanSide; ++r) {
+        for (int c = 0; c < ScanSide; ++c) {
+            int cell = r * ScanSide + c;
+            uint16_t cand = 0;
+            if (in.blankCols[r] & (1 << c)) {
+                cand = in.rowFree[r] & in.colFree[c] & in.squareFree[3 * (r / 3) + c / 3] & in.allowed[cell];
+                int count = __builtin_popcount(cand);
+                uint16_t key = scanKey(count, cell);
+                best = key < best ? key : best;
+                if (count == 1) {
+                    out.singles[cell >> 6] |= uint64_t(1) << (cell & 63);
+                }
+            }
+            out.cand[cell] = cand;
+            out.count[cell] = __builtin_popcount(cand);
+        }
+    }
+    scanFinish(best, out);
+}
+
+#ifdef SIMD_X86
+
+// AVX2 version, one grid row per 256-bit register
+__attribute__((target("avx2")))
+inline void scanAvx2(const scanInput& in, scanResult& out) {
+    const __m256i nibbleCount = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+                                                 0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+    const __m256i lowNibble = _mm256_set1_epi8(0x0F);
+    const __m256i lowByte = _mm256_set1_epi16(0xFF);
+    const __m256i one = _mm256_set1_epi16(1);
+    const __m256i ones = _mm256_set1_epi16(-1);
+    // lane k of a row stands for column k, lanes 9 to 15 get a bit no row ever has
+    const __m256i laneBit = _mm256_setr_epi16(1, 2, 4, 8, 16, 32, 64, 128, 256,
+                                              -32768, -32768, -32768, -32768, -32768, -32768, -32768);
+    const __m256i laneIndex = _mm256_setr_epi16(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+
+    alignas(32) uint16_t lanes[16] = {};
+    for (int c = 0; c < ScanSide; ++c) {
+        lanes[c] = in.colFree[c];
+    }
+    const __m256i cols = _mm256_load_si256((const __m256i*) lanes);
+
+    __m256i best = ones;
+    out.singles[0] = out.singles[1] = 0;
+    for (int band = 0; band < 3; ++band) {
+        for (int c = 0; c < ScanSide; ++c) {
+            lanes[c] = in.squareFree[3 * band + c / 3];
+        }
+        const __m256i squares = _mm256_load_si256((const __m256i*) lanes);
+
+        for (int r = 3 * band; r < 3 * band + 3; ++r) {
+            __m256i blank = _mm256_and_si256(_mm256_set1_epi16(in.blankCols[r]), laneBit);
+            blank = _mm256_cmpeq_epi16(blank, laneBit);
+            __m256i cand = _mm256_and_si256(cols, _mm256_set1_epi16(in.rowFree[r]));
+            cand = _mm256_and_si256(cand, squares);
+            cand = _mm256_and_si256(cand, _mm256_loadu_si256((const __m256i*) (in.allowed + r * ScanSide)));
+            cand = _mm256_and_si256(cand, blank);
+
+            // popcount per byte from a nibble table, then add the two bytes of each lane
+            __m256i bytes = _mm256_add_epi8(
+                _mm256_shuffle_epi8(nibbleCount, _mm256_and_si256(cand, lowNibble)),
+                _mm256_shuffle_epi8(nibbleCount, _mm256_and_si256(_mm256_srli_epi16(cand, 4), lowNibble)));
+            __m256i count = _mm256_add_epi16(_mm256_and_si256(bytes, lowByte), _mm256_srli_epi16(bytes, 8));
+
+            // the rows are stored in order, so each row's spare lanes are
+            // overwritten by the next row
+            _mm256_storeu_si256((__m256i*) (out.cand + r * ScanSide), cand);
+            _mm256_storeu_si256((__m256i*) (out.count + r * ScanSide), count);
+
+            __m256i key = _mm256_or_si256(_mm256_slli_epi16(count, 8),
+                                          _mm256_add_epi16(laneIndex, _mm256_set1_epi16(r * ScanSide)));
+            key = _mm256_or_si256(key, _mm256_andnot_si256(blank, ones));
+            best = _mm256_min_epu16(best, key);
+
+            __m256i single = _mm256_and_si256(_mm256_cmpeq_epi16(count, one), blank);
+            __m128i packed = _mm_packs_epi16(_mm256_castsi256_si128(single), _mm256_extracti128_si256(single, 1));
+            uint64_t bits = _mm_movemask_epi8(packed) & 0x1FF;
+            int cell = r * ScanSide;
+            out.singles[0] |= cell < 64 ? bits << cell : 0;
+            out.singles[1] |= cell + ScanSide > 64 ? (cell >= 64 ? bits << (cell - 64) : bits >> (64 - cell)) : 0;
+        }
+    }
+
+    __m128i low = _mm_minpos_epu16(_mm256_castsi256_si128(best));
+    __m128i high = _mm_minpos_epu16(_mm256_extracti128_si256(best, 1));
+    uint16_t lowKey = _mm_extract_epi16(low, 0);
+    uint16_t highKey = _mm_extract_epi16(high, 0);
+    scanFinish(lowKey < highKey ? lowKey : highKey, out);
+}
+
+// SSE4.1 version, one grid row per two 128-bit registers (lanes 0-7 and lane 8)
+__attribute__((target("sse4.1")))
+inline void scanSse41(const scanInput& in, scanResult& out) {
+    const __m128i nibbleCount = _mm_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+    const __m128i lowNibble = _mm_set1_epi8(0x0F);
+    const __m128i lowByte = _mm_set1_epi16(0xFF);
+    const __m128i one = _mm_set1_epi16(1);
+    const __m128i ones = _mm_set1_epi16(-1);
+    const __m128i laneBit[2] = {
+        _mm_setr_epi16(1, 2, 4, 8, 16, 32, 64, 128),
+        _mm_setr_epi16(256, -32768, -32768, -32768, -32768, -32768, -32768, -32768)
+    };
+    const __m128i laneIndex = _mm_setr_epi16(0, 1, 2, 3, 4, 5, 6, 7);
+
+    alignas(16) uint16_t lanes[16] = {};
+    for (int c = 0; c < ScanSide; ++c) {
+        lanes[c] = in.colFree[c];
+    }
+    const __m128i cols[2] = {
+        _mm_load_si128((const __m128i*) lanes), _mm_load_si128((const __m128i*) (lanes + 8))
+    };
+
+    __m128i best = ones;
+    out.singles[0] = out.singles[1] = 0;
+    for (int band = 0; band < 3; ++band) {
+        for (int c = 0; c < ScanSide; ++c) {
+            lanes[c] = in.squareFree[3 * band + c / 3];
+        }
+        const __m128i squares[2] = {
+            _mm_load_si128((const __m128i*) lanes), _mm_load_si128((const __m128i*) (lanes + 8))
+        };
+
+        for (int r = 3 * band; r < 3 * band + 3; ++r) {
+            uint64_t bits = 0;
+            for (int h = 0; h < 2; ++h) {
+                int cell = r * ScanSide + 8 * h;
+                __m128i blank = _mm_and_si128(_mm_set1_epi16(in.blankCols[r]), laneBit[h]);
+                blank = _mm_cmpeq_epi16(blank, laneBit[h]);
+                __m128i cand = _mm_and_si128(cols[h], _mm_set1_epi16(in.rowFree[r]));
+                cand = _mm_and_si128(cand, squares[h]);
+                cand = _mm_and_si128(cand, _mm_loadu_si128((const __m128i*) (in.allowed + cell)));
+                cand = _mm_and_si128(cand, blank);
+
+                __m128i bytes = _mm_add_epi8(
+                    _mm_shuffle_epi8(nibbleCount, _mm_and_si128(cand, lowNibble)),
+                    _mm_shuffle_epi8(nibbleCount, _mm_and_si128(_mm_srli_epi16(cand, 4), lowNibble)));
+                __m128i count = _mm_add_epi16(_mm_and_si128(bytes, lowByte), _mm_srli_epi16(bytes, 8));
+
+                _mm_storeu_si128((__m128i*) (out.cand + cell), cand);
+                _mm_storeu_si128((__m128i*) (out.count + cell), count);
+
+                __m128i key = _mm_or_si128(_mm_slli_epi16(count, 8),
+                                           _mm_add_epi16(laneIndex, _mm_set1_epi16(cell)));
+                key = _mm_or_si128(key, _mm_andnot_si128(blank, ones));
+                best = _mm_min_epu16(best, key);
+
+                __m128i single = _mm_and_si128(_mm_cmpeq_epi16(count, one), blank);
+                bits |= uint64_t(_mm_movemask_epi8(_mm_packs_epi16(single, single)) & 0xFF) << (8 * h);
+            }
+            bits &= 0x1FF;
+            int cell = r * ScanSide;
+            out.singles[0] |= cell < 64 ? bits << cell : 0;
+            out.singles[1] |= cell + ScanSide > 64 ? (cell >= 64 ? bits << (cell - 64) : bits >> (64 - cell)) : 0;
+        }
+    }
+
+    scanFinish(_mm_extract_epi16(_mm_minpos_epu16(best), 0), out);
+}
+
+#endif	// SIMD_X86
+
+typedef void (*scanFunction)(const scanInput& in, scanResult& out);
+
+// pick the fastest kernel the processor supports
+inline scanFunction chooseScan() {
+#ifdef SIMD_X86
+    if (__builtin_cpu_supports("avx2")) {
+        return scanAvx2;
+    }
+    if (__builtin_cpu_supports("sse4.1")) {
+        return scanSse41;
+    }
+#endif
+    return scanScalar;
+}
+
+// compute candidates, counts, the most constrained cell and the naked
+// singles of the whole grid in one pass
+inline void scanGrid(const scanInput& in, scanResult& out) {
+    static const scanFunction kernel = chooseScan();
+    kernel(in, out);
+}
+
+#endif	// SIMD_KERNEL
@@ -0,0 +1,301 @@
+/*
+This file contains the solution store, a file that maps 9x9 puzzles to their
+solutions and the statistics of the solve that found them, so a puzzle seen
+by any earlier run costs one lookup instead of a search.
+The file is a header, a hash table of slots and an array of fixed-size
+records, and it is used in place through a shared memory mapping: opening
+it reads nothing, and every process that maps it shares the same pages.
+The file is created at its full size for a fixed number of records, but is
+left sparse, so it only takes disk space as records are added.
+
+Records are only ever appended. A writer takes an exclusive flock on the
+file (and a mutex, since a flock does not keep out the writer's own
+threads), writes the record, counts it in the header and only then fills
+the slot that points to it. A reader needs no lock: a slot is published
+last, with a release store, so a reader that finds it also sees the
+record, and a writer that dies half way leaves at most a record no slot
+points to.
+*/
+
+#ifndef SOLUTION_STORE
+#define SOLUTION_STORE
+
+#include <string>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/file.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "d_except.h"
+#include "puzzlefile.h"
+#include "batch.h"
+
+using namespace std;
+
+const size_t DefaultStoreCapacity = 1 << 20; // records in a new store file
+
+class puzzleStore {
+public:
+    puzzleStore(); // constructor, no file open
+    ~puzzleStore(); // unmap the file
+    void open(const string& fileName, bool writable = false,
+              size_t capacity = DefaultStoreCapacity);
+        // map a store; a writable store is created with room for capacity
+        // records if the file does not exist. throws fileOpenError, or
+        // fileError if the file is not a store
+    void close(); // unmap the file
+    bool find(const char* puzzle, batchResult& result) const; // false if the puzzle is not stored
+    bool insert(const char* puzzle, const batchResult& result); // false if read-only, full or aborted
+    void sync(); // write the added records through to the disk
+    size_t size() const; // records stored
+    size_t capacity() const; // records the file has room for
+
+private:
+    // the first bytes of the file
+    struct storeHeader {
+        char magic[8]; // StoreMagic
+        uint32_t version; // StoreVersion
+        uint32_t recordSize; // sizeof(storeRecord) of the program that made it
+        uint64_t capacity; // records the file has room for
+        uint64_t numSlots; // slots in the hash table, a power of two
+        uint64_t count; // records written, updated under the lock
+    };
+
+    // one stored puzzle; the counts are clamped to 32 bits like BinaryFormat
+    struct storeRecord {
+        uint64_t recursiveCalls;
+        uint32_t guesses;
+        uint32_t backtracks;
+        unsigned char puzzle[PackedCells]; // see packCells
+        unsigned char solution[PackedCells];
+        unsigned char solved;
+        unsigned char maxDepth;
+    };
+
+    static constexpr char StoreMagic[8] = {'S', 'U', 'D', 'O', 'K', 'V', 'S', '1'};
+    static const uint32_t StoreVersion = 1;
+
+    char* data; // the mapping, nullptr when no file is open
+    size_t length; // bytes mapped
+    int fd; // kept open by a writer for its flock, -1 otherwise
+    storeHeader* header;
+    uint64_t* slots; // record number + 1 in the low half and the hash's high half above, 0 if empty
+    storeRecord* records;
+    mutex lock; // orders the inserts of one process, the flock orders processes
+
+    static uint64_t hash(const unsigned char* packed); // FNV-1a of a packed puzzle
+    int64_t locate(const unsigned char* packed, uint64_t h) const; // record number, -1 if none
+
+    puzzleStore(const puzzleStore&); // a mapping has one owner
+    puzzleStore& operator=(const puzzleStore&);
+};
+
+inline puzzleStore::puzzleStore() :
+    data(nullptr), length(0), fd(-1), header(nullptr), slots(nullptr), records(nullptr) {
+}
+
+inline puzzleStore::~puzzleStore() {
+    close();
+}
+
+// map a store file, creating it first if it is writable and missing
+inline void puzzleStore::open(const string& fileName, bool writable, size_t capacity) {
+    close();
+    int file = ::open(fileName.c_str(), writable ? O_RDWR | O_CREAT : O_RDONLY, 0644);
+    if (file < 0) {
+        throw fileOpenError(fileName);
+    }
+    struct stat info;
+    if (fstat(file, &info) < 0) {
+        ::close(file);
+        throw fileOpenError(fileName);
+    }
+
+    if (info.st_size == 0 && writable) {
+        // a new store: twice as many slots as records keeps the probes short
+        flock(file, LOCK_EX);
+        fstat(file, &info);
+        if (info.st_size == 0) {
+            storeHeader h = {};
+            memcpy(h.magic, StoreMagic, sizeof(h.magic));
+            h.version = StoreVersion;
+            h.recordSize = sizeof(storeRecord);
+            h.capacity = capacity < 1 ? 1 : capacity;
+            h.numSlots = 1;
+            while (h.numSlots < 2 * h.capacity) {
+                h.numSlots *= 2;
+            }
+            off_t size = sizeof(storeHeader) + h.numSlots * sizeof(uint64_t)
+                + h.capacity * sizeof(storeRecord);
+            if (ftruncate(file, size) < 0 || pwrite(file, &h, sizeof(h), 0) != sizeof(h)) {
+                flock(file, LOCK_UN);
+                ::close(file);
+                throw fileOpenError(fileName);
+            }
+            info.st_size = size;
+        }
+        flock(file, LOCK_UN);
+    }
+
+    storeHeader h;
+    if (info.st_size < off_t(sizeof(h)) || pread(file, &h, sizeof(h), 0) != sizeof(h) ||
+        memcmp(h.magic, StoreMagic, sizeof(h.magic)) != 0 || h.version != StoreVersion ||
+        h.recordSize != sizeof(storeRecord) ||
+        size_t(info.st_size) != sizeof(storeHeader) + h.numSlots * sizeof(uint64_t)
+            + h.capacity * sizeof(storeRecord)) {
+        ::close(file);
+        throw fileError("puzzleStore: " + fileName + " is not a solution store");
+    }
+
+    length = info.st_size;
+    void* map = mmap(nullptr, length, writable ? PROT_READ | PROT_WRITE : PROT_READ,
+                     MAP_SHARED, file, 0);
+    if (map == MAP_FAILED) {
+        ::close(file);
+        length = 0;
+        throw fileOpenError(fileName);
+    }
+    data = (char*) map;
+    header = (storeHeader*) data;
+    slots = (uint64_t*) (data + sizeof(storeHeader));
+    records = (storeRecord*) (data + sizeof(storeHeader) + h.numSlots * sizeof(uint64_t));
+    if (writable) {
+        fd = file; // for the flock around every insert
+    } else {
+        ::close(file); // the mapping stays valid without the descriptor
+    }
+}
+
+// unmap the file
+inline void puzzleStore::close() {
+    if (data) {
+        munmap(data, length);
+    }
+    if (fd >= 0) {
+        ::close(fd);
+    }
+    data = nullptr;
+    length = 0;
+    fd = -1;
+    header = nullptr;
+    slots = nullptr;
+    records = nullptr;
+}
+
+// hash the bytes of a packed puzzle
+inline uint64_t puzzleStore::hash(const unsigned char* packed) {
+    uint64_t h = 14695981039346656037ULL;
+    for (int k = 0; k < PackedCells; ++k) {
+        h = (h ^ packed[k]) * 1099511628211ULL;
+    }
+    return h;
+}
+
+// find the record of a packed puzzle by probing from its home slot
+inline int64_t puzzleStore::locate(const unsigned char* packed, uint64_t h) const {
+    uint64_t mask = header->numSlots - 1;
+    uint64_t tag = h >> 32;
+    for (uint64_t s = h & mask; ; s = (s + 1) & mask) {
+        uint64_t slot = __atomic_load_n(&slots[s], __ATOMIC_ACQUIRE);
+        if (slot == 0) {
+            return -1;
+        }
+        uint64_t n = (slot & 0xFFFFFFFF) - 1;
+        if (slot >> 32 == tag && n < header->capacity &&
+            memcmp(records[n].puzzle, packed, PackedCells) == 0) {
+            return n;
+        }
+    }
+}
+
+// look up a puzzle of 81 characters and fill in what was stored for it. A
+// puzzle with characters other than '.' and '1' to '9' packs like a plain
+// one with blanks in their place, so it is never looked up or stored
+inline bool puzzleStore::find(const char* puzzle, batchResult& result) const {
+    if (!data || !isPlainBoard(puzzle)) {
+        return false;
+    }
+    unsigned char packed[PackedCells];
+    packCells(puzzle, packed);
+    int64_t n = locate(packed, hash(packed));
+    if (n < 0) {
+        return false;
+    }
+    const storeRecord& r = records[n];
+    char cells[RecordSize];
+    unpackCells(r.solution, cells);
+    result.solution.assign(cells, RecordSize);
+    result.solved = r.solved;
+    result.recursiveCalls = r.recursiveCalls;
+    result.guesses = r.guesses;
+    result.backtracks = r.backtracks;
+    result.maxDepth = r.maxDepth;
+    result.solutions = r.solved;
+    result.counted = false;
+    result.aborted = false;
+    result.invalid = false;
+    return true;
+}
+
+// append what solving a puzzle of 81 characters found; a puzzle that is
+// already stored is left as it is, and a search that gave up proves nothing
+// so it is not stored
+inline bool puzzleStore::insert(const char* puzzle, const batchResult& result) {
+    if (fd < 0 || result.aborted || !isPlainBoard(puzzle)) {
+        return false;
+    }
+    storeRecord r = {};
+    packCells(puzzle, r.puzzle);
+    packCells(result.solution.c_str(), r.solution);
+    r.solved = result.solved;
+    r.recursiveCalls = result.recursiveCalls;
+    r.guesses = result.guesses > 0xFFFFFFFFLL ? 0xFFFFFFFF : result.guesses;
+    r.backtracks = result.backtracks > 0xFFFFFFFFLL ? 0xFFFFFFFF : result.backtracks;
+    r.maxDepth = result.maxDepth;
+    uint64_t h = hash(r.puzzle);
+
+    lock_guard<mutex> guard(lock);
+    flock(fd, LOCK_EX);
+    bool added = false;
+    uint64_t n = header->count;
+    if (locate(r.puzzle, h) >= 0) {
+        added = true; // another process got there first
+    } else if (n < header->capacity) {
+        records[n] = r;
+        // count the record before any slot points to it, so a writer that
+        // dies here only wastes the record
+        __atomic_store_n(&header->count, n + 1, __ATOMIC_RELEASE);
+        uint64_t mask = header->numSlots - 1;
+        uint64_t s = h & mask;
+        while (slots[s] != 0) {
+            s = (s + 1) & mask;
+        }
+        __atomic_store_n(&slots[s], (h >> 32) << 32 | (n + 1), __ATOMIC_RELEASE);
+        added = true;
+    }
+    flock(fd, LOCK_UN);
+    return added;
+}
+
+// make the records added so far survive a crash of the machine, not just of
+// the process
+inline void puzzleStore::sync() {
+    if (data && fd >= 0) {
+        msync(data, length, MS_SYNC);
+    }
+}
+
+// get the number of records stored
+inline size_t puzzleStore::size() const {
+    return data ? __atomic_load_n(&header->count, __ATOMIC_ACQUIRE) : 0;
+}
+
+// get the number of records the file has room for
+inline size_t puzzleStore::capacity() const {
+    return data ? header->capacity : 0;
+}
+
+#endif	// SOLUTION_STORE
@@ -0,0 +1,124 @@
+/*
+This file contains the symmetries of the 9x9 board.
+Relabelling the values, swapping rows inside a band, swapping whole bands,
+doing the same with columns and stacks, and transposing the grid all turn a
+valid puzzle into another valid puzzle with the same number of solutions and
+the same difficulty. A boardTransform holds one such combination and
+applies it to a board in file format.
+*/
+
+#ifndef BOARD_TRANSFORM
+#define BOARD_TRANSFORM
+
+#include <string>
+#include <random>
+#include <algorithm>
+#include "board.h"
+
+using namespace std;
+
+// one symmetry of the board; cell (i, j) of the result is cell
+// (row[i], col[j]) of the original (swapped when transpose is set),
+// with its value v written as digit[v]
+struct boardTransform {
+    int digit[MaxValue + 1]; // new value for each value, digit[0] unused
+    int row[BoardSize]; // source row of each row, 0-based
+    int col[BoardSize]; // source column of each column, 0-based
+    bool transpose; // read the source with rows and columns swapped
+};
+
+// return the transform that leaves every board as it is
+inline boardTransform identityTransform() {
+    boardTransform t;
+    for (int v = 0; v <= MaxValue; ++v) {
+        t.digit[v] = v;
+    }
+    for (int k = 0; k < BoardSize; ++k) {
+        t.row[k] = t.col[k] = k;
+    }
+    t.transpose = false;
+    return t;
+}
+
+// fill order with a shuffle of the lines of a band or stack layout: the
+// squares are shuffled as blocks and the lines inside each block as well
+template <typename Rng>
+void shuffleLines(int order[BoardSize], Rng& rng) {
+    int blocks[SquareSize];
+    for (int b = 0; b < SquareSize; ++b) {
+        blocks[b] = b;
+    }
+    shuffle(blocks, blocks + SquareSize, rng);
+    for (int b = 0; b < SquareSize; ++b) {
+        int lines[SquareSize];
+        for (int k = 0; k < SquareSize; ++k) {
+            lines[k] = blocks[b] * SquareSize + k;
+        }
+        shuffle(lines, lines + SquareSize, rng);
+        for (int k = 0; k < SquareSize; ++k) {
+            order[b * SquareSize + k] = lines[k];
+        }
+    }
+}
+
+// return a transform picked uniformly at random from the whole group
+template <typename Rng>
+boardTransform randomTransform(Rng& rng) {
+    boardTransform t = identityTransform();
+    shuffle(t.digit + MinValue, t.digit + MaxValue + 1, rng);
+    shuffleLines(t.row, rng);
+    shuffleLines(t.col, rng);
+    t.transpose = rng() & 1;
+    return t;
+}
+
+// return the transform that undoes t, so applying both gives the board back
+inline boardTransform invertTransform(const boardTransform& t) {
+    boardTransform inv;
+    inv.digit[0] = 0;
+    for (int v = MinValue; v <= MaxValue; ++v) {
+        inv.digit[t.digit[v]] = v;
+    }
+    // result cell (r, c) came from source (row[r], col[c]); with transpose
+    // the source was read with rows and columns swapped, so they swap back
+    int rowInv[BoardSize], colInv[BoardSize];
+    for (int k = 0; k < BoardSize; ++k) {
+        rowInv[t.row[k]] = k;
+        colInv[t.col[k]] = k;
+    }
+    for (int k = 0; k < BoardSize; ++k) {
+        inv.row[k] = t.transpose ? colInv[k] : rowInv[k];
+        inv.col[k] = t.transpose ? rowInv[k] : colInv[k];
+    }
+    inv.transpose = t.transpose;
+    return inv;
+}
+
+// check that a board of 81 characters holds only '.' and '1' to '9', the
+// characters a transform can map
+inline bool isPlainBoard(const char* cells) {
+    for (int k = 0; k < BoardSize * BoardSize; ++k) {
+        if (cells[k] != '.' && (cells[k] < '1' || cells[k] > '9')) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// apply a transform to a plain board of 81 characters in file format
+inline string applyTransform(const boardTransform& t, const char* cells) {
+    string out(BoardSize * BoardSize, '.');
+    for (int i = 0; i < BoardSize; ++i) {
+        for (int j = 0; j < BoardSize; ++j) {
+            int r = t.row[i];
+            int c = t.col[j];
+            char ch = t.transpose ? cells[c * BoardSize + r] : cells[r * BoardSize + c];
+            if (ch != '.') {
+                out[i * BoardSize + j] = '0' + t.digit[ch - '0'];
+            }
+        }
+    }
+    return out;
+}
+
+#endif	// BOARD_TRANSFORM